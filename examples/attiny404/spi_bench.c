@@ -0,0 +1,155 @@
+/**
+ * @file spi_bench.c
+ * @brief SPI0 throughput benchmark for ATtiny404
+ *
+ * Clocks a 256-byte block out of SPI0 with the byte-at-a-time API and
+ * with each buffered block transfer, timed with TCA0 at F_CPU. Prints
+ * cycles per byte and throughput via USART0. A byte at DIV4 takes 32
+ * cycles on the wire; anything above that is gap between bytes.
+ *
+ * The interrupt-driven transfer is measured by running fixed chunks of
+ * main-loop work until it completes. Wall time minus the calibrated cost
+ * of the chunks is what the SPI0 interrupt consumed; "cpu" is that per
+ * byte, against the polled paths which keep the CPU busy for the whole
+ * transfer.
+ *
+ * No slave is needed: tie MOSI (PA1) to MISO (PA2) to also check that
+ * the received data matches.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay_basic.h>
+#include <stdio.h>
+#include "attiny404/attiny404.h"
+
+#define BENCH_LEN 256
+
+static uint8_t tx_buf[BENCH_LEN];
+static uint8_t rx_buf[BENCH_LEN];
+
+static void timer_start(void) {
+    TCA0.SINGLE.CTRLA = 0;
+    TCA0.SINGLE.CTRLB = TCA_SINGLE_WGMODE_NORMAL_gc;
+    TCA0.SINGLE.PER = 0xFFFF;
+    TCA0.SINGLE.CNT = 0;
+    TCA0.SINGLE.CTRLA = TCA_SINGLE_CLKSEL_DIV1_gc | TCA_SINGLE_ENABLE_bm;
+}
+
+static uint16_t timer_stop(void) {
+    uint16_t cycles = TCA0.SINGLE.CNT;
+    TCA0.SINGLE.CTRLA = 0;
+    return cycles;
+}
+
+// One chunk of main-loop work, ~80 cycles
+static void work(void) {
+    _delay_loop_1(25);
+}
+
+static uint16_t work_cycles(void) {
+    uint16_t cycles;
+
+    timer_start();
+    for (uint8_t i = 0; i < 100; i++) {
+        work();
+        (void)spi_is_busy();
+    }
+    cycles = timer_stop();
+
+    return cycles / 100;
+}
+
+static void report(usart_t *uart, const char *name, uint16_t cycles) {
+    char buf[48];
+    uint32_t kbps = (uint32_t)BENCH_LEN * 8 * (F_CPU / 1000) / cycles;
+
+    sprintf(buf, "%-9s %3u cyc/B %5lu kbit/s\r\n", name,
+            cycles / BENCH_LEN, (unsigned long)kbps);
+    usart_puts(uart, buf);
+}
+
+static void bench(usart_t *uart, spi_clock_t clock) {
+    spi_config_t config = {
+        .mode = SPI_MODE_0,
+        .clock = clock,
+        .msb_first = 1
+    };
+    uint16_t cycles;
+    uint16_t errors = 0;
+
+    spi_init(config);
+
+    timer_start();
+    for (uint16_t i = 0; i < BENCH_LEN; i++) {
+        rx_buf[i] = spi_transfer(tx_buf[i]);
+    }
+    cycles = timer_stop();
+    report(uart, "bytewise", cycles);
+
+    timer_start();
+    spi_transfer_block(tx_buf, rx_buf, BENCH_LEN);
+    cycles = timer_stop();
+    report(uart, "transfer", cycles);
+
+    for (uint16_t i = 0; i < BENCH_LEN; i++) {
+        if (rx_buf[i] != tx_buf[i]) {
+            errors++;
+        }
+    }
+
+    timer_start();
+    spi_write_block(tx_buf, BENCH_LEN);
+    cycles = timer_stop();
+    report(uart, "write", cycles);
+
+    timer_start();
+    spi_read_block(rx_buf, BENCH_LEN);
+    cycles = timer_stop();
+    report(uart, "read", cycles);
+
+    uint16_t chunk = work_cycles();
+    uint16_t chunks = 0;
+
+    timer_start();
+    spi_transfer_async(tx_buf, rx_buf, BENCH_LEN, NULL);
+    do {
+        work();
+        chunks++;
+    } while (spi_is_busy());
+    cycles = timer_stop();
+    report(uart, "async", cycles);
+
+    char buf[40];
+    uint16_t busy = cycles - chunks * chunk;
+    sprintf(buf, "async cpu %u cyc/B\r\n", busy / BENCH_LEN);
+    usart_puts(uart, buf);
+
+    sprintf(buf, "loopback errors: %u\r\n", errors);
+    usart_puts(uart, buf);
+}
+
+int main(void) {
+    usart_config_t uart_config = {
+        .baud = USART_BAUD_115200,
+        .databits = USART_DATABITS_8,
+        .parity = USART_PARITY_NONE,
+        .stopbits = USART_STOPBITS_1
+    };
+
+    usart_t uart = usart_init(uart_config);
+    sei();
+
+    for (uint16_t i = 0; i < BENCH_LEN; i++) {
+        tx_buf[i] = (uint8_t)i;
+    }
+
+    usart_puts(&uart, "SPI0 bench, DIV4\r\n");
+    bench(&uart, SPI_CLK_DIV4);
+
+    usart_puts(&uart, "SPI0 bench, DIV16\r\n");
+    bench(&uart, SPI_CLK_DIV16);
+
+    while (1) {
+    }
+}
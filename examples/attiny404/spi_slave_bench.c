@@ -0,0 +1,78 @@
+/**
+ * @file spi_slave_bench.c
+ * @brief SPI0 slave clock-rate benchmark for ATtiny404
+ *
+ * Finds the highest host SCK the SPI0 slave sustains. The host sends
+ * frames of bytes counting up from 0 with no gap between bytes. The
+ * slave answers each byte with its value plus one, which the host sees
+ * two slots later:
+ *
+ *   host sends:   00 01 02 03 04 ...
+ *   slave sends:  FF FF 01 02 03 ...
+ *
+ * The slave reports each frame on USART0. Raise the host SCK until
+ * either side sees errors; the last clean rate is the limit for the
+ * current F_CPU. The host should wait for each report before the next
+ * frame.
+ *
+ * Wiring: MOSI PA1, MISO PA2, SCK PA3, SS PA4, USART0 TX PB2
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdio.h>
+#include "attiny404/attiny404.h"
+
+static volatile uint8_t rx_errors;
+static volatile uint8_t frame_length;
+static volatile uint8_t frame_done;
+
+static uint8_t on_byte(uint8_t index, uint8_t data) {
+    if (data != index) {
+        rx_errors++;
+    }
+    return data + 1;
+}
+
+static void on_frame(uint8_t length) {
+    frame_length = length;
+    frame_done = 1;
+}
+
+int main(void) {
+    usart_config_t uart_config = {
+        .baud = USART_BAUD_115200,
+        .databits = USART_DATABITS_8,
+        .parity = USART_PARITY_NONE,
+        .stopbits = USART_STOPBITS_1
+    };
+
+    spi_slave_config_t slave_config = {
+        .mode = SPI_MODE_0,
+        .msb_first = 1,
+        .on_byte = on_byte,
+        .on_frame = on_frame
+    };
+
+    usart_t uart = usart_init(uart_config);
+    spi_slave_init(slave_config);
+    sei();
+
+    usart_puts(&uart, "SPI slave bench\r\n");
+
+    while (1) {
+        if (frame_done) {
+            char buf[40];
+            uint8_t sreg = SREG;
+            cli();
+            uint8_t length = frame_length;
+            uint8_t errors = rx_errors;
+            rx_errors = 0;
+            frame_done = 0;
+            SREG = sreg;
+
+            sprintf(buf, "len=%u rx_err=%u\r\n", length, errors);
+            usart_puts(&uart, buf);
+        }
+    }
+}
@@ -8,6 +8,7 @@
 #include <avr/io.h>
 #include <util/delay.h>
 #include <stdio.h>
+#include <stddef.h>
 #include "attiny404/attiny404.h"
 
 int main(void) {
@@ -23,21 +24,20 @@ int main(void) {
     };
 
     usart_t uart = usart_init(uart_config);
-    twi_t twi = twi_init(twi_config);
+    twi_init(twi_config);
 
     usart_puts(&uart, "I2C Scanner\r\n");
 
     while (1) {
         uint8_t found = 0;
         for (uint8_t addr = 1; addr < 128; addr++) {
-            twi_start();
-            if (TWI0.MSTATUS & TWI_RXACK_bm) {
+            // Empty write: START, address, STOP; TWI_OK means it was ACKed
+            if (twi_write_status(addr, NULL, 0) == TWI_OK) {
                 char buf[32];
                 sprintf(buf, "Found: 0x%02X\r\n", addr);
                 usart_puts(&uart, buf);
                 found = 1;
             }
-            twi_stop();
         }
         if (!found) {
             usart_puts(&uart, "No devices found\r\n");
@@ -0,0 +1,174 @@
+/**
+ * @file adc_oversample_bench.c
+ * @brief ADC oversampling benchmark for ATtiny85
+ *
+ * Part 1 simulates the ADC in software to show what oversampling buys.
+ * A known input, swept over 256 points between two codes, is given
+ * triangular noise of +-1 LSB (about 0.4 LSB rms), quantized to 10 bits
+ * and decimated exactly like the driver (sum of 4^n samples >> n). The
+ * spread of the error around its mean gives the effective number of
+ * bits: ENOB = 10 - log2(rms error in LSB * sqrt(12)). The same run with
+ * no noise shows that a quiet input gains nothing.
+ *
+ * Part 2 runs adc_oversample_start() on ADC2 (PB4) and counts ring
+ * results over about one second, timed by Timer1 overflows (F_CPU / 1024).
+ *
+ * Results are printed on the soft UART (TX on PB3).
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdio.h>
+#include "attiny85/attiny85.h"
+
+#define SIM_POINTS      256
+#define SIM_MAX_BITS    4
+
+// Timer1 at F_CPU / 1024 overflows every 16.384 ms at 16 MHz
+#define RATE_OVERFLOWS  61
+
+static uint16_t lfsr = 0xACE1;
+
+static uint16_t xorshift16(void) {
+    lfsr ^= lfsr << 7;
+    lfsr ^= lfsr >> 9;
+    lfsr ^= lfsr << 8;
+    return lfsr;
+}
+
+// Triangular noise in 1/256 LSB, -255 to +255
+static int16_t noise_q8(void) {
+    return (int16_t)(xorshift16() & 0xFF) + (int16_t)(xorshift16() & 0xFF) - 255;
+}
+
+// log2(x) in 8.8 fixed point, x > 0
+static uint16_t log2_q8(uint32_t x) {
+    uint8_t k = 31;
+    while (!(x & 0x80000000UL)) {
+        x <<= 1;
+        k--;
+    }
+
+    uint32_t y = x >> 16;   // mantissa in [1, 2) as Q15
+    uint16_t result = (uint16_t)k << 8;
+
+    for (uint8_t bit = 0x80; bit; bit >>= 1) {
+        y = (y * y) >> 15;
+        if (y >= 0x10000UL) {
+            y >>= 1;
+            result |= bit;
+        }
+    }
+    return result;
+}
+
+// ENOB in 8.8 fixed point, 0xFFFF if the error never varied
+static uint16_t simulate(uint8_t bits, uint8_t noisy) {
+    int32_t sum_e = 0;
+    uint32_t sum_e2 = 0;
+
+    for (uint16_t p = 0; p < SIM_POINTS; p++) {
+        int32_t input = 512L * 256 + p;     // 1/256 LSB steps over one code
+        uint16_t n = 1U << (2 * bits);
+        uint32_t acc = 0;
+
+        do {
+            int32_t v = input + (noisy ? noise_q8() : 0);
+            int16_t code = (int16_t)(v >> 8);
+            if (code < 0) {
+                code = 0;
+            } else if (code > 1023) {
+                code = 1023;
+            }
+            acc += (uint16_t)code;
+        } while (--n);
+
+        int32_t result_q8 = (int32_t)(acc >> bits) << (8 - bits);
+        int32_t e = result_q8 - input;
+        sum_e += e;
+        sum_e2 += (uint32_t)(e * e);
+    }
+
+    // Variance in LSB^2 / 65536
+    int32_t mean = sum_e / SIM_POINTS;
+    uint32_t var = sum_e2 / SIM_POINTS - (uint32_t)(mean * mean);
+    if (var == 0) {
+        return 0xFFFF;
+    }
+
+    // ENOB = 10 - log2(sqrt(12 * var / 65536)) = 18 - log2(12 * var) / 2
+    return (18U << 8) - log2_q8(12 * var) / 2;
+}
+
+static void print_enob(uart_t *uart, const char *label, uint8_t bits, uint16_t enob) {
+    char buf[48];
+
+    if (enob == 0xFFFF) {
+        sprintf(buf, "%s n=%u: no error spread\r\n", label, bits);
+    } else {
+        sprintf(buf, "%s n=%u: ENOB %u.%02u\r\n", label, bits,
+                enob >> 8, (uint16_t)((enob & 0xFF) * 100U) >> 8);
+    }
+    uart_puts(uart, buf);
+}
+
+static uint16_t measure_rate(adc_t *adc, uint8_t bits, uint8_t *overruns) {
+    uint16_t results = 0;
+    uint8_t overflows = 0;
+    uint16_t value;
+
+    adc_oversample_start(adc, ADC_CHANNEL_2, bits);
+
+    TCNT1 = 0;
+    TIFR = (1 << TOV1);
+    TCCR1 = (1 << CS13) | (1 << CS11) | (1 << CS10);
+
+    while (overflows < RATE_OVERFLOWS) {
+        while (adc_ring_read(adc, &value)) {
+            results++;
+        }
+        if (TIFR & (1 << TOV1)) {
+            TIFR = (1 << TOV1);
+            overflows++;
+        }
+    }
+
+    TCCR1 = 0;
+    adc_free_run_stop(adc);
+    *overruns = adc_overruns(adc);
+    return results;
+}
+
+int main(void) {
+    uart_config_t uart_config = {
+        .tx_pin = 3,
+        .rx_pin = 5,
+        .baudrate = 9600
+    };
+
+    char buf[48];
+
+    uart_t uart = uart_init(uart_config);
+    adc_t adc = adc_init(ADC_REF_VCC, ADC_PRESCALER_128);
+    adc_enable(&adc);
+
+    uart_puts(&uart, "ADC oversampling bench\r\n");
+
+    for (uint8_t bits = 0; bits <= SIM_MAX_BITS; bits++) {
+        print_enob(&uart, "quiet", bits, simulate(bits, 0));
+        print_enob(&uart, "noisy", bits, simulate(bits, 1));
+    }
+
+    sei();
+
+    for (uint8_t bits = 0; bits <= SIM_MAX_BITS; bits++) {
+        uint8_t overruns;
+        uint16_t rate = measure_rate(&adc, bits, &overruns);
+
+        sprintf(buf, "n=%u: %u results/s, %u overruns\r\n", bits, rate, overruns);
+        uart_puts(&uart, buf);
+    }
+
+    while (1) {
+    }
+}
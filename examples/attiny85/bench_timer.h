@@ -0,0 +1,46 @@
+/**
+ * @file bench_timer.h
+ * @brief Cycle counter shared by the ATtiny85 benchmarks
+ *
+ * Timer0 counts F_CPU / 64 and Timer1 counts F_CPU / 16384. Both are
+ * started and stopped together through GTCCR TSM, so Timer1 holds the
+ * number of Timer0 overflows. Together they give a 16-bit count of
+ * 64-cycle ticks (up to ~4.2 M cycles) that needs no interrupt and
+ * works with interrupts disabled.
+ *
+ * Takes over Timer0 and Timer1 while a measurement runs.
+ */
+
+#ifndef BENCH_TIMER_H
+#define BENCH_TIMER_H
+
+#include <stdint.h>
+#include <avr/io.h>
+
+#define BENCH_TIMER_HALT ((1 << TSM) | (1 << PSR1) | (1 << PSR0))
+
+static inline void bench_timer_start(void) {
+    // Both prescalers are held in reset until GTCCR is cleared
+    GTCCR = BENCH_TIMER_HALT;
+    TCCR0A = 0;
+    TCCR0B = (1 << CS01) | (1 << CS00);
+    TCCR1 = (1 << CS13) | (1 << CS12) | (1 << CS11) | (1 << CS10);
+    TCNT0 = 0;
+    TCNT1 = 0;
+    GTCCR = 0;
+}
+
+// Elapsed time in 64-cycle ticks
+static inline uint16_t bench_timer_stop(void) {
+    GTCCR = BENCH_TIMER_HALT;
+    uint8_t low = TCNT0;
+    uint8_t high = TCNT1;
+
+    TCCR0B = 0;
+    TCCR1 = 0;
+    GTCCR = 0;
+
+    return ((uint16_t)high << 8) | low;
+}
+
+#endif // BENCH_TIMER_H
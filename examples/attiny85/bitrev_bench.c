@@ -0,0 +1,104 @@
+/**
+ * @file bitrev_bench.c
+ * @brief Bit reversal and LSB-first SPI benchmark for ATtiny85
+ *
+ * Times each bit reversal variant over all 256 byte values, then the
+ * cost of an SPI_CLK_DIV2 byte in MSB-first and LSB-first order, and
+ * prints cycles per byte on the soft UART (TX on PB3).
+ *
+ * bench_timer.h counts 64-cycle ticks in 16 bits. Loop overhead is
+ * measured with an empty loop and subtracted. Results are printed in
+ * 1/4 cycle units for the 256-value runs ("q" suffix).
+ *
+ * The LSB-first SPI figure depends on HAL_BITREV_TABLE_SIZE the
+ * library was built with.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdio.h>
+#include "attiny85/attiny85.h"
+#include "bench_timer.h"
+
+#define SPI_BENCH_LEN 64
+
+static volatile uint8_t sink;
+
+static uint8_t bitrev8_loop(uint8_t data) {
+    uint8_t out = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        out = (out << 1) | (data & 0x01);
+        data >>= 1;
+    }
+    return out;
+}
+
+// 256 values * 64 cycles per tick: ticks equal quarter cycles per byte
+#define BENCH_256(result, expr) do {        \
+    uint8_t i = 0;                          \
+    bench_timer_start();                    \
+    do {                                    \
+        sink = (expr);                      \
+    } while (++i);                          \
+    (result) = bench_timer_stop();          \
+} while (0)
+
+static uint16_t bench_spi(spi_t *spi, const uint8_t *tx, uint8_t *rx) {
+    bench_timer_start();
+    spi_transfer_buf(spi, tx, rx, SPI_BENCH_LEN);
+    return bench_timer_stop();
+}
+
+int main(void) {
+    uart_config_t uart_config = {
+        .tx_pin = 3,
+        .rx_pin = 5,
+        .baudrate = 9600
+    };
+
+    spi_config_t spi_config = {
+        .sclk_pin = 2,
+        .mosi_pin = 0,
+        .miso_pin = 1,
+        .mode = SPI_MODE_0,
+        .bit_order = SPI_BIT_ORDER_MSB_FIRST,
+        .clock = SPI_CLK_DIV2
+    };
+
+    static uint8_t tx[SPI_BENCH_LEN];
+    static uint8_t rx[SPI_BENCH_LEN];
+    char buf[48];
+
+    uart_t uart = uart_init(uart_config);
+    spi_t spi = spi_init(spi_config);
+
+    for (uint8_t i = 0; i < SPI_BENCH_LEN; i++) {
+        tx[i] = i;
+    }
+
+    uart_puts(&uart, "Bit reversal bench\r\n");
+
+    uint16_t base, table, nibble, loop;
+
+    cli();
+    BENCH_256(base, i);
+    BENCH_256(table, hal_bitrev8_table(i));
+    BENCH_256(nibble, hal_bitrev8_nibble(i));
+    BENCH_256(loop, bitrev8_loop(i));
+
+    // 64 bytes * 64 cycles per tick: ticks equal cycles per byte
+    uint16_t msb = bench_spi(&spi, tx, rx);
+    spi.config.bit_order = SPI_BIT_ORDER_LSB_FIRST;
+    uint16_t lsb = bench_spi(&spi, tx, rx);
+    sei();
+
+    sprintf(buf, "table=%uq nibble=%uq loop=%uq\r\n",
+            table - base, nibble - base, loop - base);
+    uart_puts(&uart, buf);
+
+    sprintf(buf, "spi div2 msb=%u lsb=%u cycles/byte\r\n", msb, lsb);
+    uart_puts(&uart, buf);
+
+    while (1) {
+    }
+}
@@ -0,0 +1,102 @@
+/**
+ * @file filter_bench.c
+ * @brief Fixed-point filter benchmark for ATtiny85
+ *
+ * Runs each filter over the same 32-sample block (a noisy ramp with a
+ * few spikes, in the range of 10-bit ADC results) and prints cycles per
+ * sample on the soft UART (TX on PB3).
+ *
+ * bench_timer.h counts 64-cycle ticks. Every filter runs over all 32
+ * samples, so one tick is two cycles per sample. Loop overhead is
+ * measured with a copy loop and subtracted.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdio.h>
+#include "attiny85/attiny85.h"
+#include "bench_timer.h"
+
+#define BLOCK       32
+
+static int16_t input[BLOCK];
+static volatile int16_t sink;
+
+// count samples at 64 cycles per tick: ticks * 64 / count cycles per sample
+#define BENCH_BLOCK(result, count, expr) do {       \
+    bench_timer_start();                            \
+    for (uint8_t i = 0; i < (count); i++) {         \
+        sink = (expr);                              \
+    }                                               \
+    (result) = bench_timer_stop();                  \
+} while (0)
+
+int main(void) {
+    uart_config_t uart_config = {
+        .tx_pin = 3,
+        .rx_pin = 5,
+        .baudrate = 9600
+    };
+
+    // Butterworth low-pass, fc = fs / 20
+    static const filter_biquad_coeffs_t lowpass = {
+        .b0 = FILTER_Q14(0.020083),
+        .b1 = FILTER_Q14(0.040167),
+        .b2 = FILTER_Q14(0.020083),
+        .a1 = FILTER_Q14(-1.561018),
+        .a2 = FILTER_Q14(0.641352)
+    };
+
+    static int16_t ma_buf[16];
+    char buf[48];
+
+    uart_t uart = uart_init(uart_config);
+
+    uint16_t seed = 0xACE1;
+    for (uint8_t i = 0; i < BLOCK; i++) {
+        seed ^= seed << 7;
+        seed ^= seed >> 9;
+        seed ^= seed << 8;
+        input[i] = 300 + i * 8 + (seed & 0x0F);
+        if ((i & 0x07) == 5) {
+            input[i] += 400;
+        }
+    }
+
+    filter_ema_t ema = filter_ema_init(4);
+    filter_ma_t ma = filter_ma_init(ma_buf, 4);
+    filter_biquad_t bq = filter_biquad_init(&lowpass);
+    filter_median_t med3 = filter_median_init(3);
+    filter_median_t med9 = filter_median_init(9);
+
+    // Prime the filters so the timed runs take the steady-state path
+    filter_ema(&ema, input[0]);
+    filter_ma(&ma, input[0]);
+    filter_median(&med3, input[0]);
+    filter_median(&med9, input[0]);
+
+    uart_puts(&uart, "Filter bench (cycles/sample)\r\n");
+
+    uint16_t base, t_ema, t_ma, t_bq, t_med3, t_med9;
+
+    cli();
+    BENCH_BLOCK(base, BLOCK, input[i]);
+    BENCH_BLOCK(t_ema, BLOCK, filter_ema(&ema, input[i]));
+    BENCH_BLOCK(t_ma, BLOCK, filter_ma(&ma, input[i]));
+    BENCH_BLOCK(t_bq, BLOCK, filter_biquad(&bq, input[i]));
+    BENCH_BLOCK(t_med3, BLOCK, filter_median(&med3, input[i]));
+    BENCH_BLOCK(t_med9, BLOCK, filter_median(&med9, input[i]));
+    sei();
+
+    sprintf(buf, "ema=%u ma16=%u\r\n", 2 * (t_ema - base), 2 * (t_ma - base));
+    uart_puts(&uart, buf);
+
+    sprintf(buf, "biquad=%u\r\n", 2 * (t_bq - base));
+    uart_puts(&uart, buf);
+
+    sprintf(buf, "median3=%u median9=%u\r\n", 2 * (t_med3 - base), 2 * (t_med9 - base));
+    uart_puts(&uart, buf);
+
+    while (1) {
+    }
+}
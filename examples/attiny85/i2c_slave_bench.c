@@ -0,0 +1,70 @@
+/**
+ * @file i2c_slave_bench.c
+ * @brief USI I2C slave register map benchmark for ATtiny85
+ *
+ * Exposes 16 registers at address 0x20:
+ *
+ *   0x00-0x07  read/write scratch
+ *   0x08-0x0F  read-only, register n holds n * 17
+ *
+ * The master writes a pattern to 0x00-0x07, reads 0x00-0x0F back in one
+ * burst and checks both halves, raising SCL until reads fail or the bus
+ * stalls. Watch SCL on a scope: the low phase after each byte and ACK
+ * bit is stretched by the overflow ISR, everything else runs at the
+ * master's rate. Each write-complete callback is reported on the soft
+ * UART (TX on PB3).
+ *
+ * Wiring: SDA PB0, SCL PB2 (external pull-ups), UART TX PB3
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdio.h>
+#include "attiny85/attiny85.h"
+
+#define REG_COUNT 16
+
+static uint8_t regs[REG_COUNT];
+static const uint8_t write_mask[REG_COUNT] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+static uart_t uart;
+
+static void on_write(uint8_t reg, uint8_t count) {
+    char buf[32];
+
+    sprintf(buf, "write reg=%u count=%u\r\n", reg, count);
+    uart_puts(&uart, buf);
+}
+
+int main(void) {
+    uart_config_t uart_config = {
+        .tx_pin = 3,
+        .rx_pin = 5,
+        .baudrate = 9600
+    };
+
+    i2c_slave_config_t slave_config = {
+        .address = 0x20,
+        .regs = regs,
+        .write_mask = write_mask,
+        .size = REG_COUNT,
+        .on_write = on_write
+    };
+
+    for (uint8_t i = 8; i < REG_COUNT; i++) {
+        regs[i] = i * 17;
+    }
+
+    uart = uart_init(uart_config);
+    i2c_slave_t slave = i2c_slave_init(slave_config);
+    sei();
+
+    uart_puts(&uart, "I2C slave bench\r\n");
+
+    while (1) {
+        i2c_slave_poll(&slave);
+    }
+}
@@ -0,0 +1,77 @@
+/**
+ * @file spi_slave_bench.c
+ * @brief USI SPI slave clock-rate benchmark for ATtiny85
+ *
+ * Finds the highest host SCK the USI slave tolerates. The host sends
+ * frames of bytes counting up from 0 with no gap between bytes. The
+ * slave answers each byte with its value plus one, which the host sees
+ * two slots later (double-buffered responses):
+ *
+ *   host sends:   00 01 02 03 04 ...
+ *   slave sends:  FF FF 01 02 03 ...
+ *
+ * The slave reports each frame on the soft UART (TX on PB3). Raise the
+ * host SCK until either side sees errors; the last clean rate is the
+ * limit for the current F_CPU. The soft UART blocks with interrupts
+ * enabled, so the host should wait for each report before the next frame.
+ *
+ * Wiring: MOSI PB0, MISO PB1, SCK PB2, CS PB4, UART TX PB3
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdio.h>
+#include "attiny85/attiny85.h"
+
+static volatile uint8_t rx_errors;
+static volatile uint8_t frame_length;
+static volatile uint8_t frame_done;
+
+static uint8_t on_byte(uint8_t index, uint8_t data) {
+    if (data != index) {
+        rx_errors++;
+    }
+    return data + 1;
+}
+
+static void on_frame(uint8_t length) {
+    frame_length = length;
+    frame_done = 1;
+}
+
+int main(void) {
+    uart_config_t uart_config = {
+        .tx_pin = 3,
+        .rx_pin = 5,
+        .baudrate = 9600
+    };
+
+    spi_slave_config_t slave_config = {
+        .cs_pin = GPIO_PB4,
+        .mode = SPI_MODE_0,
+        .on_byte = on_byte,
+        .on_frame = on_frame
+    };
+
+    uart_t uart = uart_init(uart_config);
+    spi_slave_init(slave_config);
+    sei();
+
+    uart_puts(&uart, "SPI slave bench\r\n");
+
+    while (1) {
+        if (frame_done) {
+            char buf[40];
+            uint8_t sreg = SREG;
+            cli();
+            uint8_t length = frame_length;
+            uint8_t errors = rx_errors;
+            rx_errors = 0;
+            frame_done = 0;
+            SREG = sreg;
+
+            sprintf(buf, "len=%u rx_err=%u\r\n", length, errors);
+            uart_puts(&uart, buf);
+        }
+    }
+}
@@ -4,6 +4,14 @@
 #include <stdint.h>
 #include <avr/io.h>
 
+// Most channels in one scan list
+#ifndef ADC_SCAN_MAX_CHANNELS
+#define ADC_SCAN_MAX_CHANNELS 8
+#endif
+
+// Most extra bits from oversampling (4^6 = 4096 samples, 16-bit results)
+#define ADC_OVERSAMPLE_MAX_BITS 6
+
 typedef enum {
     ADC_CH_AIN0 = 0x00,
     ADC_CH_AIN1 = 0x01,
@@ -17,6 +25,7 @@ typedef enum {
     ADC_CH_AIN9 = 0x09,
     ADC_CH_AIN10 = 0x0A,
     ADC_CH_AIN11 = 0x0B,
+    ADC_CH_INTREF = 0x1D,
     ADC_CH_TEMPSENSE = 0x1E,
     ADC_CH_DAC0 = 0x1F,
 } adc_channel_t;
@@ -47,6 +56,27 @@ typedef enum {
     ADC_RES_10BIT,
 } adc_resolution_t;
 
+// Per-unit sensor calibration. Temperature comes from the factory values
+// in SIGROW; temp_trim_cdeg is added on top. intref_mv is the measured
+// 1.1V reference, VDD * RES / 1024 on ADC_CH_INTREF against a known VDD.
+typedef struct {
+    int16_t temp_trim_cdeg;     // default 0
+    uint16_t intref_mv;         // default 1100
+} adc_calibration_t;
+
+// Runs from the ADC0 interrupt with the half of the buffer that just
+// filled; it has until the other half fills to use the samples
+typedef void (*adc_stream_callback_t)(uint16_t *samples, uint16_t count);
+
+typedef struct {
+    adc_channel_t channel;
+    uint16_t rate_hz;
+    uint16_t *buffer;                   // double buffer, both halves
+    uint16_t length;                    // samples, even
+    adc_stream_callback_t on_half;      // can be NULL
+    adc_stream_callback_t on_full;      // can be NULL
+} adc_stream_config_t;
+
 typedef struct {
     adc_reference_t ref;
     adc_prescaler_t prescaler;
@@ -61,6 +91,8 @@ void adc_enable();
 
 void adc_disable();
 
+// The single-conversion, oversampled and sensor reads stop a running
+// scan or stream first; restart it afterwards
 uint16_t adc_read_blocking(adc_t *adc, adc_channel_t channel);
 
 void adc_read_start(adc_t *adc, adc_channel_t channel);
@@ -69,4 +101,46 @@ uint8_t adc_is_busy(adc_t *adc);
 
 uint16_t adc_read_result();
 
+// Oversampled blocking read: sums 4^extra_bits samples and shifts right
+// by extra_bits, adding extra_bits of resolution when the input has
+// about 1 LSB of noise. Up to 64 samples are summed by the ADC itself
+// (SAMPNUM); beyond that whole 64-sample results are summed in software.
+uint16_t adc_read_oversampled(adc_t *adc, adc_channel_t channel, uint8_t extra_bits);
+
+// Die temperature in 1/100 C and supply voltage in mV. Both select the
+// reference, sample time and init delay the sensor needs, discard the
+// first conversion, let the ADC accumulate four samples and restore the
+// caller's ADC0 and VREF settings. Integer math only.
+int16_t adc_read_temperature_cdeg(adc_t *adc);
+
+uint16_t adc_read_vcc_mv(adc_t *adc);
+
+void adc_calibration_set(const adc_calibration_t *cal);
+
+// Fixed-rate sampling: TCA0 overflows at rate_hz and the overflow event
+// starts each conversion through the event system (sync channel 0), with
+// no software in the path. Samples fill the buffer; on_half and on_full
+// run as each half fills, then it wraps. TCA0 is configured from F_CPU;
+// returns the actual rate, 0 if out of range or if a period is shorter
+// than one conversion at the current prescaler, SAMPLEN, SAMPDLY and
+// SAMPNUM plus the interrupt entry. Takes over TCA0 and event sync
+// channel 0. Needs global interrupts enabled.
+uint16_t adc_stream_start(adc_t *adc, const adc_stream_config_t *config);
+
+void adc_stream_stop(adc_t *adc);
+
+// Scan sequencer: ADC0 runs free-running and the RESRDY interrupt moves
+// MUXPOS along the channel list (copied, up to ADC_SCAN_MAX_CHANNELS).
+// Results fill a back table that is swapped with the front table when
+// the last channel lands. Needs global interrupts enabled. The
+// single-conversion functions stop the scan.
+void adc_scan_start(adc_t *adc, const adc_channel_t *channels, uint8_t count);
+
+void adc_scan_stop(adc_t *adc);
+
+// Copies the latest complete scan, one value per channel in list order.
+// Returns a sequence number that changes with every complete scan
+// (1-255, wraps past 0); 0 until the first scan is done.
+uint8_t adc_scan_read(adc_t *adc, uint16_t *results);
+
 #endif
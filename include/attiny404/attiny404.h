@@ -19,7 +19,9 @@ extern "C" {
 #include "adc/adc.h"
 #include "usart/usart.h"
 #include "twi/twi.h"
+#include "twi/twi_client.h"
 #include "spi/spi.h"
+#include "spi/spi_slave.h"
 
 #ifdef __cplusplus
 }
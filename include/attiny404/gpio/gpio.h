@@ -173,6 +173,29 @@ static inline uint8_t gpio_is_low(gpio_pin_t pin) {
     return gpio_read(pin) == GPIO_LOW;
 }
 
+/**
+ * @brief Enable pin change interrupt for a pin
+ *
+ * The callback runs from the PORTA/PORTB interrupt with the pin that
+ * triggered it.
+ *
+ * @param pin Pin identifier
+ * @param mode Edge(s) that trigger the interrupt
+ * @param callback Function called on the selected edge(s)
+ *
+ * @note Requires global interrupts enabled
+ * @note Defined in gpio_pcint.c together with PORTA_PORT_vect and
+ *       PORTB_PORT_vect, which are only linked in when this is called
+ */
+void gpio_enable_pcint(gpio_pin_t pin, gpio_pcint_mode_t mode, gpio_pcint_callback_t callback);
+
+/**
+ * @brief Disable pin change interrupt for a pin
+ *
+ * @param pin Pin identifier
+ */
+void gpio_disable_pcint(gpio_pin_t pin);
+
 /**
  * @brief Get port and pin from pin identifier
  *
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <avr/io.h>
+#include "attiny404/gpio/gpio.h"
 
 typedef enum {
     SPI_MODE_0,
@@ -28,6 +29,26 @@ typedef struct {
     spi_config_t config;
 } spi_t;
 
+// One slave on the bus; spi_device_init() fills in the cached fields
+typedef struct {
+    gpio_pin_t cs_pin;
+    spi_mode_t mode;
+    spi_clock_t clock;
+    uint8_t msb_first:1;
+    uint8_t ctrla;
+    uint8_t ctrlb;
+    volatile uint8_t *cs_port;
+    uint8_t cs_mask;
+} spi_device_t;
+
+typedef struct {
+    const uint8_t *tx;      // NULL sends 0xFF
+    uint8_t *rx;            // NULL discards
+    uint16_t len;
+} spi_segment_t;
+
+typedef void (*spi_callback_t)(void);
+
 spi_t spi_init(spi_config_t config);
 
 uint8_t spi_transfer(uint8_t data);
@@ -36,6 +57,34 @@ void spi_write(uint8_t data);
 
 uint8_t spi_read();
 
+// Block transfers keep the TX buffer topped up so SCK runs without gaps
+// between bytes. Write-only discards received bytes, read-only sends 0xFF.
+void spi_transfer_block(const uint8_t *tx, uint8_t *rx, uint16_t len);
+
+void spi_write_block(const uint8_t *tx, uint16_t len);
+
+void spi_read_block(uint8_t *rx, uint16_t len);
+
 void spi_deinit(void);
 
+void spi_device_init(spi_device_t *dev);
+
+// Asserts CS, runs the segments back to back, deasserts CS. Bus settings
+// are only rewritten when the device differs from the previous call.
+void spi_transaction(const spi_device_t *dev, const spi_segment_t *segments, uint8_t count);
+
+// Interrupt-driven transfers: return immediately, the SPI0 interrupt
+// clocks the bytes and the callback runs from it when the last byte is
+// in. Segments (and their buffers) must stay valid until then. A new
+// call waits for the previous one. Requires global interrupts enabled.
+// Defined in spi_async.c together with SPI0_INT_vect, which is only
+// linked in when one of them is called.
+void spi_transfer_async(const uint8_t *tx, uint8_t *rx, uint16_t len, spi_callback_t callback);
+
+// Chains the segments under one CS assertion without gaps between them
+void spi_transaction_async(const spi_device_t *dev, const spi_segment_t *segments,
+                           uint8_t count, spi_callback_t callback);
+
+uint8_t spi_is_busy(void);
+
 #endif
@@ -0,0 +1,60 @@
+#ifndef HAL_SPI404_SLAVE_H
+#define HAL_SPI404_SLAVE_H
+
+#include <stdint.h>
+#include <avr/io.h>
+#include "attiny404/gpio/gpio.h"
+#include "attiny404/spi/spi.h"
+
+// Interrupt-driven SPI0 slave. MOSI PA1, MISO PA2, SCK PA3, SS PA4.
+// MISO is driven only while SS is low. Owns SPI0_INT_vect, so it cannot
+// be linked together with the SPI0 master async functions in
+// spi_async.c. The polled master in spi.c is fine.
+
+#ifndef SPI_SLAVE_RX_SIZE
+#define SPI_SLAVE_RX_SIZE 16    // power of two
+#endif
+
+#ifndef SPI_SLAVE_TX_SIZE
+#define SPI_SLAVE_TX_SIZE 16    // power of two
+#endif
+
+// Called from the SPI0 interrupt for each received byte. The returned
+// byte goes out in slot index + 2; the first two slots of a frame send
+// 0xFF. Must return within one byte time of the host clock.
+typedef uint8_t (*spi_slave_byte_callback_t)(uint8_t index, uint8_t data);
+
+// Called from the pin interrupt when SS goes high, after the last byte
+// of the frame has been stored
+typedef void (*spi_slave_frame_callback_t)(uint8_t length);
+
+typedef struct {
+    spi_mode_t mode;
+    uint8_t msb_first:1;
+    spi_slave_byte_callback_t on_byte;      // NULL: RX/TX rings
+    spi_slave_frame_callback_t on_frame;    // can be NULL
+} spi_slave_config_t;
+
+typedef struct {
+    spi_slave_config_t config;
+} spi_slave_t;
+
+spi_slave_t spi_slave_init(spi_slave_config_t config);
+
+void spi_slave_deinit(void);
+
+uint8_t spi_slave_available(void);
+
+uint8_t spi_slave_read(uint8_t *data);
+
+// Queues a response byte. Slots with nothing queued send 0xFF. The
+// first two slots of a frame are loaded when the previous frame ends
+// (SS rising), so bytes queued after that start from slot 2. Bytes
+// loaded into SPI0 but not clocked out before SS rises are sent again
+// in the next frame. Returns 0 if the TX ring is full.
+uint8_t spi_slave_write(uint8_t data);
+
+// Returns and clears the number of bytes dropped on a full RX ring
+uint8_t spi_slave_overruns(void);
+
+#endif
@@ -7,28 +7,97 @@
 typedef enum {
     TWI_BAUD_100KHZ,
     TWI_BAUD_400KHZ,
+    TWI_BAUD_1MHZ,      // Fast-mode Plus, FMPEN set
 } twi_baud_t;
 
+// Spec maximum SCL/SDA rise time per mode, used when rise_ns is 0
+#define TWI_RISE_100KHZ_NS  1000
+#define TWI_RISE_400KHZ_NS  300
+#define TWI_RISE_1MHZ_NS    120
+
+// Blocking calls give up after this long without bus progress, used
+// when timeout_us is 0
+#ifndef TWI_DEFAULT_TIMEOUT_US
+#define TWI_DEFAULT_TIMEOUT_US 1000
+#endif
+
+// MBAUD is computed from F_CPU, the target rate and the bus rise time,
+// then raised if needed to keep SCL low for the mode's minimum tLOW
 typedef struct {
     twi_baud_t baud;
+    uint16_t rise_ns;       // measured bus rise time, 0: spec maximum
+    uint16_t timeout_us;    // max time a slave may hold SCL low, 0: default
 } twi_config_t;
 
 typedef struct {
     twi_config_t config;
 } twi_t;
 
+typedef enum {
+    TWI_OK,
+    TWI_ERR_NACK,       // address or data byte not acknowledged
+    TWI_ERR_ARBLOST,    // another master won the bus
+    TWI_ERR_BUSERR,     // illegal START/STOP seen on the bus
+    TWI_ERR_TIMEOUT,    // no bus progress for timeout_us (SCL held low)
+    TWI_PENDING,        // queued or in progress
+} twi_status_t;
+
+struct twi_xfer;
+
+typedef void (*twi_callback_t)(struct twi_xfer *xfer);
+
+// One transaction: START, addr+W and the write segment, repeated START,
+// addr+R and the read segment (last byte NACKed), STOP. Either segment
+// may be empty. Caller-owned; it and its buffers must stay valid until
+// status leaves TWI_PENDING.
+typedef struct twi_xfer {
+    uint8_t addr;
+    const uint8_t *tx;
+    uint8_t tx_len;
+    uint8_t *rx;
+    uint8_t rx_len;
+    twi_callback_t callback;        // runs from the TWI0 interrupt, may be NULL
+    volatile twi_status_t status;
+    struct twi_xfer *next;          // queue link, driver use
+} twi_xfer_t;
+
 twi_t twi_init(twi_config_t config);
 
-void twi_start(void);
+// Queues a transaction and returns at once. The TWI0 master interrupt
+// runs the queue in order; errors end only the transaction they hit.
+void twi_submit(twi_xfer_t *xfer);
 
-void twi_stop(void);
+uint8_t twi_is_busy(void);
 
-uint8_t twi_write(uint8_t data);
+// Blocking wrappers around twi_submit(). Also work with interrupts
+// disabled, in which case they service TWI0 by polling. If no byte moves
+// for timeout_us, the transaction holding the bus ends with
+// TWI_ERR_TIMEOUT and the bus state is forced back to idle.
+twi_status_t twi_write_status(uint8_t addr, const uint8_t *data, uint8_t len);
 
-uint8_t twi_read(uint8_t ack);
+twi_status_t twi_read_status(uint8_t addr, uint8_t *data, uint8_t len);
 
+// Original interface: 1 on success, 0 on any error
 uint8_t twi_write_bytes(uint8_t addr, const uint8_t *data, uint8_t len);
 
 uint8_t twi_read_bytes(uint8_t addr, uint8_t *data, uint8_t len);
 
+// Write then read with a repeated START in between and no STOP, so the
+// device keeps its register pointer. The last read byte is NACKed
+// together with the STOP command.
+twi_status_t twi_write_read(uint8_t addr, const uint8_t *wbuf, uint8_t wlen,
+                            uint8_t *rbuf, uint8_t rlen);
+
+// Deprecated byte-level interface, kept for existing code. twi_start()
+// waits for the queue to drain and turns the master interrupts off until
+// twi_stop(); don't call twi_submit() in between. New code should use
+// the transaction functions above.
+void twi_start(void);
+
+void twi_stop(void);
+
+uint8_t twi_write(uint8_t data);
+
+uint8_t twi_read(uint8_t ack);
+
 #endif
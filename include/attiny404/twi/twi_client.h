@@ -0,0 +1,57 @@
+#ifndef HAL_TWI404_CLIENT_H
+#define HAL_TWI404_CLIENT_H
+
+#include <stdint.h>
+#include <avr/io.h>
+#include "attiny404/twi/twi.h"
+
+// Interrupt-driven TWI0 client (slave) exposing a register file. SDA PA1,
+// SCL PA2. Owns TWI0_TWIS_vect; can run alongside the master in twi.c.
+//
+// The first byte of a master write sets the register pointer, later
+// bytes are stored there. Reads start at the pointer. The pointer
+// auto-increments and wraps at size.
+//
+// Smart mode is on, so one SDATA access per byte both moves the data
+// and sends the ACK. SCL is held only for the interrupt latency.
+
+// Called from the TWI0 client interrupt on STOP after a master write
+typedef void (*twi_client_write_callback_t)(uint8_t reg, uint8_t count);
+
+typedef struct {
+    uint8_t address;                        // own 7-bit address
+    twi_baud_t speed;                       // highest master rate; TWI_BAUD_1MHZ sets FMPEN
+    uint8_t *regs;                          // register file the master sees
+    uint8_t *shadow;                        // second buffer, same size, NULL: single-buffered
+    const uint8_t *write_mask;              // writable bits per register, NULL: all
+    uint8_t size;
+    twi_client_write_callback_t on_write;   // can be NULL
+} twi_client_config_t;
+
+typedef struct {
+    twi_client_config_t config;
+} twi_client_t;
+
+// Sets only the SDA hold and FMPEN bits of the shared TWI0.CTRLA. A size
+// of 0 is rejected: the client is left untouched and not enabled.
+twi_client_t twi_client_init(twi_client_config_t config);
+
+void twi_client_deinit(void);
+
+// Double buffering: the application updates the buffer returned here,
+// then publishes it. The buffers are swapped between transactions, so a
+// master reading several bytes never sees a half-updated value. Without
+// a shadow buffer this returns regs and publish does nothing.
+uint8_t *twi_client_regs(void);
+
+// Swaps the buffers and copies the new front into the new back buffer.
+// Does not wait: if a transaction is running, the swap is deferred to
+// its STOP and 0 is returned, otherwise 1. Until the deferred swap has
+// happened the back buffer may change hands at any time, so leave it
+// alone while twi_client_publish_pending() returns 1, then fetch it
+// again with twi_client_regs().
+uint8_t twi_client_publish(void);
+
+uint8_t twi_client_publish_pending(void);
+
+#endif
@@ -18,6 +18,40 @@
  * @{
  */
 
+/**
+ * @brief Free-running ring size in samples (power of two, at most 128)
+ */
+#ifndef ADC_RING_SIZE
+#define ADC_RING_SIZE 32
+#endif
+
+/**
+ * @brief Most channels in one scan list
+ */
+#ifndef ADC_SCAN_MAX_CHANNELS
+#define ADC_SCAN_MAX_CHANNELS 8
+#endif
+
+/**
+ * @brief Most extra bits from oversampling (4^6 = 4096 samples, 16-bit results)
+ */
+#define ADC_OVERSAMPLE_MAX_BITS 6
+
+/**
+ * @brief Times adc_read_quiet() repeats a conversion disturbed by an
+ *        early wakeup
+ */
+#ifndef ADC_QUIET_RETRIES
+#define ADC_QUIET_RETRIES 2
+#endif
+
+/**
+ * @brief Wait after switching to the temperature sensor or bandgap, in us
+ */
+#ifndef ADC_REF_SETTLE_US
+#define ADC_REF_SETTLE_US 1000
+#endif
+
 /**
  * @brief ADC channel identifier
  */
@@ -26,8 +60,17 @@ typedef enum {
     ADC_CHANNEL_1 = 1,    ///< ADC1 on PB2
     ADC_CHANNEL_2 = 2,    ///< ADC2 on PB4
     ADC_CHANNEL_3 = 3,    ///< ADC3 on PB3
-    ADC_CHANNEL_TEMP = 8,   ///< Internal temperature sensor
-    ADC_CHANNEL_1V1 = 14,  ///< Internal 1.1V reference
+    ADC_CHANNEL_DIFF_2_2_X1 = 4,    ///< ADC2 - ADC2, 1x (offset)
+    ADC_CHANNEL_DIFF_2_2_X20 = 5,   ///< ADC2 - ADC2, 20x (offset)
+    ADC_CHANNEL_DIFF_2_3_X1 = 6,    ///< PB4 - PB3, 1x
+    ADC_CHANNEL_DIFF_2_3_X20 = 7,   ///< PB4 - PB3, 20x
+    ADC_CHANNEL_DIFF_0_0_X1 = 8,    ///< ADC0 - ADC0, 1x (offset)
+    ADC_CHANNEL_DIFF_0_0_X20 = 9,   ///< ADC0 - ADC0, 20x (offset)
+    ADC_CHANNEL_DIFF_0_1_X1 = 10,   ///< PB5 - PB2, 1x
+    ADC_CHANNEL_DIFF_0_1_X20 = 11,  ///< PB5 - PB2, 20x
+    ADC_CHANNEL_1V1 = 12,   ///< Internal 1.1V bandgap
+    ADC_CHANNEL_GND = 13,   ///< 0V (GND)
+    ADC_CHANNEL_TEMP = 15,  ///< Internal temperature sensor (ADC4)
 } adc_channel_t;
 
 /**
@@ -65,6 +108,42 @@ typedef enum {
     ADC_ERROR,               ///< Error occurred
 } adc_status_t;
 
+/**
+ * @brief Per-unit sensor calibration
+ *
+ * Defaults are the datasheet typical values. A one-point calibration
+ * only needs ts_code_25c; bandgap_mv is VCC * code / 1024 measured on
+ * ADC_CHANNEL_1V1 against a known VCC.
+ */
+typedef struct {
+    uint16_t ts_code_25c;       ///< Temperature sensor code at 25 C (typ. 300)
+    uint16_t ts_cdeg_per_lsb;   ///< Sensor slope, centidegrees per LSB in 8.8 (typ. 23771)
+    uint16_t bandgap_mv;        ///< Bandgap voltage in mV (typ. 1100)
+} adc_calibration_t;
+
+/**
+ * @brief Stream buffer callback
+ *
+ * Runs from ADC_vect with the half of the buffer that just filled.
+ * It has until the other half fills to use the samples.
+ *
+ * @param samples First sample of the filled half
+ * @param count Samples in that half
+ */
+typedef void (*adc_stream_callback_t)(uint16_t *samples, uint16_t count);
+
+/**
+ * @brief Timer-triggered stream configuration
+ */
+typedef struct {
+    adc_channel_t channel;
+    uint16_t rate_hz;                   ///< Sample rate
+    uint16_t *buffer;                   ///< Double buffer, both halves
+    uint16_t length;                    ///< Buffer length in samples (even)
+    adc_stream_callback_t on_half;      ///< First half filled, can be NULL
+    adc_stream_callback_t on_full;      ///< Second half filled, can be NULL
+} adc_stream_config_t;
+
 /**
  * @brief ADC handle
  */
@@ -72,6 +151,7 @@ typedef struct {
     adc_reference_t ref;
     adc_prescaler_t prescaler;
     uint8_t in_progress:1;
+    uint8_t bipolar:1;
     uint8_t channel;
 } adc_t;
 
@@ -109,6 +189,8 @@ void adc_disable(adc_t *adc);
  * @brief Blocking ADC read
  *
  * Starts conversion on specified channel and blocks until complete.
+ * Stops any free-running, scan or stream mode first and waits for its
+ * conversion in flight, so the result is always for this channel.
  *
  * @param adc ADC handle
  * @param channel ADC channel to read
@@ -116,15 +198,165 @@ void adc_disable(adc_t *adc);
  */
 uint16_t adc_read_blocking(adc_t *adc, adc_channel_t channel);
 
+/**
+ * @brief Conversion in ADC noise reduction sleep
+ *
+ * Enters SLEEP_MODE_ADC, which stops the CPU and I/O clocks and starts
+ * the conversion, and wakes on ADC_vect. The digital switching noise of
+ * a running CPU is absent while the ADC samples, and the CPU draws
+ * nothing while it waits.
+ *
+ * Any other enabled interrupt (pin change, INT0, watchdog, USI start)
+ * can wake the CPU first. Its handler runs and the CPU goes back to
+ * sleep until the result arrives. A conversion that finished with the
+ * CPU awake is repeated, up to ADC_QUIET_RETRIES times; after that the
+ * last result is returned.
+ *
+ * @param adc ADC handle
+ * @param channel ADC channel to read
+ * @return 10-bit ADC value (0-1023)
+ *
+ * @note Global interrupts are enabled while sleeping and SREG is
+ *       restored afterwards. The sleep mode bits are also restored, so
+ *       this can be mixed with hal_sleep_enable().
+ * @note Stops any free-running, oversampling or scan mode, like
+ *       adc_read_blocking()
+ */
+uint16_t adc_read_quiet(adc_t *adc, adc_channel_t channel);
+
+/**
+ * @brief Select unipolar or bipolar differential mode
+ *
+ * Unipolar (the default) reads 0-1023 and clips negative differences
+ * to 0. Bipolar (BIN) reads -512..511 at half the resolution per
+ * polarity. Changing the mode drops the stored offsets.
+ *
+ * @param adc ADC handle
+ * @param enable Non-zero for bipolar
+ */
+void adc_set_bipolar(adc_t *adc, uint8_t enable);
+
+/**
+ * @brief Measure the differential offsets now
+ *
+ * Converts each shorted-input channel (ADC2-ADC2, ADC0-ADC0, at 1x and
+ * 20x) and stores the average. This happens on its own the first time
+ * a differential channel is used after adc_init() or
+ * adc_set_bipolar() in adc_read_signed() or adc_scan_start(); call it
+ * again after large temperature or supply changes. adc_read_start()
+ * does not measure offsets itself and needs this call first.
+ *
+ * @param adc ADC handle
+ */
+void adc_diff_calibrate(adc_t *adc);
+
+/**
+ * @brief Convert a raw result to a signed, offset-corrected value
+ *
+ * Sign-extends bipolar results and subtracts the stored offset of the
+ * channel's pair and gain. Single-ended channels are returned as is.
+ * Use it on results from adc_read_poll() and adc_scan_read().
+ *
+ * @param adc ADC handle
+ * @param channel Channel the result was read from
+ * @param raw Raw result
+ * @return Signed result in LSB
+ */
+int16_t adc_to_signed(adc_t *adc, adc_channel_t channel, uint16_t raw);
+
+/**
+ * @brief Blocking signed read
+ *
+ * adc_read_blocking() followed by adc_to_signed(). When the MUX moves
+ * to a differential channel, the first conversion is discarded while
+ * the gain stage settles.
+ *
+ * @param adc ADC handle
+ * @param channel ADC channel to read
+ * @return Signed result in LSB
+ *
+ * @example
+ * @code
+ * adc_t adc = adc_init(ADC_REF_INTERNAL_1V1, ADC_PRESCALER_128);
+ * adc_enable(&adc);
+ * adc_set_bipolar(&adc, 1);
+ *
+ * // 0.1 ohm shunt between PB4 and PB3: 1 LSB = 1.1V / 512 / 20 = 107 uV
+ * int16_t lsb = adc_read_signed(&adc, ADC_CHANNEL_DIFF_2_3_X20);
+ * int32_t ua = (int32_t)lsb * 1074;
+ * @endcode
+ */
+int16_t adc_read_signed(adc_t *adc, adc_channel_t channel);
+
+/**
+ * @brief Read the die temperature
+ *
+ * Switches to the 1.1V reference and the sensor channel, waits
+ * ADC_REF_SETTLE_US when they were not already selected, discards one
+ * conversion and averages four. The caller's reference and channel
+ * are restored afterwards. Integer math only.
+ *
+ * @param adc ADC handle
+ * @return Temperature in 1/100 C
+ *
+ * @note Uncalibrated parts can be off by +-10 C; see
+ *       adc_calibration_set()
+ */
+int16_t adc_read_temperature_cdeg(adc_t *adc);
+
+/**
+ * @brief Read the supply voltage
+ *
+ * Measures the 1.1V bandgap against VCC and returns
+ * bandgap_mv * 1024 / code. Settling and averaging as for
+ * adc_read_temperature_cdeg().
+ *
+ * @param adc ADC handle
+ * @return VCC in mV
+ */
+uint16_t adc_read_vcc_mv(adc_t *adc);
+
+/**
+ * @brief Replace the sensor calibration
+ *
+ * @param cal New calibration values
+ */
+void adc_calibration_set(const adc_calibration_t *cal);
+
+/**
+ * @brief Load the sensor calibration from EEPROM
+ *
+ * Expects a record written by adc_calibration_store(). The current
+ * values are kept if none is found.
+ *
+ * @param eeprom_addr EEPROM address of the record (8 bytes)
+ * @return Non-zero if a record was loaded
+ */
+uint8_t adc_calibration_load(uint16_t eeprom_addr);
+
+/**
+ * @brief Store a sensor calibration record in EEPROM
+ *
+ * @param eeprom_addr EEPROM address of the record (8 bytes)
+ * @param cal Calibration values to store
+ */
+void adc_calibration_store(uint16_t eeprom_addr, const adc_calibration_t *cal);
+
 /**
  * @brief Start non-blocking conversion
  *
  * Starts conversion on specified channel. Returns immediately
  * without waiting for completion.
  *
+ * A differential channel needs its offset measured first with
+ * adc_diff_calibrate(), since that takes blocking conversions. When the
+ * MUX moves to a differential channel, ADC_vect discards the first
+ * conversion while the gain stage settles and starts a second one.
+ *
  * @param adc ADC handle
  * @param channel ADC channel to read
- * @return ADC_BUSY if started, ADC_OK if already complete
+ * @return ADC_BUSY if started, ADC_ERROR for a differential channel
+ *         whose offset has not been measured
  *
  * @note Only one conversion can be in progress at a time
  */
@@ -138,6 +370,11 @@ adc_status_t adc_read_start(adc_t *adc, adc_channel_t channel);
  * @param adc ADC handle
  * @param out_value Pointer to store result (can be NULL)
  * @return ADC_OK if complete, ADC_BUSY if in progress
+ *
+ * @note The result is delivered by ADC_vect, so global interrupts must
+ *       be enabled
+ * @note A blocking read issued before the poll finishes the started
+ *       conversion first and keeps its result for this call
  */
 adc_status_t adc_read_poll(adc_t *adc, uint16_t *out_value);
 
@@ -149,6 +386,196 @@ adc_status_t adc_read_poll(adc_t *adc, uint16_t *out_value);
  */
 uint8_t adc_is_busy(adc_t *adc);
 
+/**
+ * @brief Start free-running conversions into the ring
+ *
+ * Sets ADATE with the free-running trigger source, so each conversion
+ * starts the next one at the full ADC rate (13 ADC clocks per sample).
+ * ADC_vect pushes results into a ring of ADC_RING_SIZE samples.
+ *
+ * @param adc ADC handle
+ * @param channel ADC channel to sample
+ * @param decimation Conversions averaged into each ring entry (1-64,
+ *        0 treated as 1, larger values clamped to 64)
+ *
+ * @note Requires global interrupts enabled
+ *
+ * @example
+ * @code
+ * adc_free_run_start(&adc, ADC_CHANNEL_2, 4);
+ * sei();
+ *
+ * uint16_t sample;
+ * while (adc_ring_read(&adc, &sample)) {
+ *     process(sample);
+ * }
+ * @endcode
+ */
+void adc_free_run_start(adc_t *adc, adc_channel_t channel, uint8_t decimation);
+
+/**
+ * @brief Stop free-running conversions
+ *
+ * Waits for the conversion in flight. Samples already in the ring can
+ * still be read.
+ *
+ * @param adc ADC handle
+ */
+void adc_free_run_stop(adc_t *adc);
+
+/**
+ * @brief Number of samples waiting in the ring
+ *
+ * @param adc ADC handle
+ * @return Samples available
+ */
+uint8_t adc_available(adc_t *adc);
+
+/**
+ * @brief Take the oldest sample from the ring
+ *
+ * @param adc ADC handle
+ * @param value Pointer to store the sample
+ * @return Non-zero if a sample was read
+ */
+uint8_t adc_ring_read(adc_t *adc, uint16_t *value);
+
+/**
+ * @brief Get and clear the ring overrun count
+ *
+ * @param adc ADC handle
+ * @return Samples dropped because the ring was full (saturates at 255)
+ */
+uint8_t adc_overruns(adc_t *adc);
+
+/**
+ * @brief Oversampled blocking read
+ *
+ * Sums 4^extra_bits conversions in a 32-bit accumulator and shifts the
+ * sum right by extra_bits, giving a (10 + extra_bits)-bit result. The
+ * ADC runs free-running during the burst and the flag is polled, so
+ * this works with interrupts disabled.
+ *
+ * The extra bits are only real if the input carries about 1 LSB of
+ * noise (or dither); a perfectly quiet input just repeats one code.
+ *
+ * @param adc ADC handle
+ * @param channel ADC channel to read
+ * @param extra_bits Bits of resolution to add (0 to ADC_OVERSAMPLE_MAX_BITS)
+ * @return Result, 0 to (1024 << extra_bits) - 1
+ *
+ * @note 4^extra_bits conversions: 12-bit takes 16, 14-bit takes 256
+ */
+uint16_t adc_read_oversampled(adc_t *adc, adc_channel_t channel, uint8_t extra_bits);
+
+/**
+ * @brief Start continuous oversampling into the ring
+ *
+ * Like adc_free_run_start(), but ADC_vect sums 4^extra_bits conversions
+ * in a 32-bit accumulator and pushes each (10 + extra_bits)-bit result
+ * into the ring. Read with adc_ring_read(), stop with adc_free_run_stop().
+ *
+ * @param adc ADC handle
+ * @param channel ADC channel to sample
+ * @param extra_bits Bits of resolution to add (0 to ADC_OVERSAMPLE_MAX_BITS)
+ *
+ * @note Requires global interrupts enabled
+ */
+void adc_oversample_start(adc_t *adc, adc_channel_t channel, uint8_t extra_bits);
+
+/**
+ * @brief Start fixed-rate sampling triggered by Timer0
+ *
+ * Runs Timer0 in CTC mode at the requested rate and sets the ADC
+ * auto-trigger source to compare match A, so each conversion starts on
+ * a timer edge with no software in the path. ADC_vect stores samples
+ * into the buffer and calls on_half and on_full as each half fills,
+ * then wraps around.
+ *
+ * The prescaler and OCR0A are picked from F_CPU. The rate is exact
+ * when F_CPU divides evenly; otherwise it is the nearest rate the
+ * timer can make. At 16 MHz the range is 62 Hz to just under the ADC
+ * conversion rate: a period must cover 14 clocks of the configured ADC
+ * prescaler plus the entry into ADC_vect, which re-arms the trigger
+ * (about 8.7 kHz with ADC_PRESCALER_128). Faster rates return 0.
+ *
+ * @param adc ADC handle
+ * @param config Stream configuration; the buffer must stay valid
+ * @return Actual sample rate in Hz, 0 if the rate is out of range
+ *
+ * @note Takes over Timer0 (PWM, delays based on it, Timer0-clocked
+ *       SPI and i2c_async cannot run at the same time)
+ * @note Requires global interrupts enabled
+ */
+uint16_t adc_stream_start(adc_t *adc, const adc_stream_config_t *config);
+
+/**
+ * @brief Stop the stream and Timer0
+ *
+ * Waits for the conversion in flight.
+ *
+ * @param adc ADC handle
+ */
+void adc_stream_stop(adc_t *adc);
+
+/**
+ * @brief Start scanning a list of channels
+ *
+ * Runs the ADC free-running and moves ADMUX to the next channel in
+ * ADC_vect. Each result goes into a back table; when the last channel
+ * of the list lands, the back and front tables are swapped, so
+ * adc_scan_read() always sees one complete scan.
+ *
+ * @param adc ADC handle
+ * @param channels Channel list, copied (up to ADC_SCAN_MAX_CHANNELS)
+ * @param count Number of channels in the list
+ *
+ * @note Requires global interrupts enabled. adc_read_blocking() stops
+ *       the scan.
+ *
+ * @example
+ * @code
+ * static const adc_channel_t list[] = { ADC_CHANNEL_1, ADC_CHANNEL_2, ADC_CHANNEL_3 };
+ * uint16_t values[3];
+ * uint8_t seen = 0;
+ *
+ * adc_scan_start(&adc, list, 3);
+ * sei();
+ *
+ * while (1) {
+ *     uint8_t seq = adc_scan_read(&adc, values);
+ *     if (seq != seen) {
+ *         seen = seq;
+ *         process(values);
+ *     }
+ * }
+ * @endcode
+ */
+void adc_scan_start(adc_t *adc, const adc_channel_t *channels, uint8_t count);
+
+/**
+ * @brief Stop scanning
+ *
+ * Waits for the conversion in flight. The last complete table can
+ * still be read.
+ *
+ * @param adc ADC handle
+ */
+void adc_scan_stop(adc_t *adc);
+
+/**
+ * @brief Copy the latest complete scan
+ *
+ * Copies one value per channel, in list order. Interrupts are held off
+ * only for the copy, never for a conversion.
+ *
+ * @param adc ADC handle
+ * @param results Buffer with room for the channel count
+ * @return Scan sequence number, incremented for each complete scan
+ *         (1-255, wraps past 0). 0 means no scan has completed yet.
+ */
+uint8_t adc_scan_read(adc_t *adc, uint16_t *results);
+
 /** @} */ // end of hal_adc
 
 #endif // HAL_ADC_H
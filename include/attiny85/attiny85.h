@@ -18,10 +18,16 @@ extern "C" {
 #include "power/power.h"
 #include "eeprom/eeprom.h"
 #include "usi/spi.h"
+#include "usi/spi_slave.h"
 #include "usi/i2c.h"
+#include "usi/i2c_async.h"
+#include "usi/i2c_slave.h"
 #include "uart/uart.h"
 #include "util/assert.h"
 #include "util/atomic.h"
+#include "util/bitrev.h"
+#include "dsp/filter.h"
+#include "dsp/goertzel.h"
 
 #ifdef __cplusplus
 }
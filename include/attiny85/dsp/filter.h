@@ -0,0 +1,191 @@
+/**
+ * @file filter.h
+ * @brief Fixed-point streaming filters for ADC samples
+ *
+ * One sample in, one sample out, no floating point. Each filter keeps
+ * its state in a small struct, so it can run inside an ADC stream
+ * callback or on each value of a scan table:
+ *
+ * | Filter              | State (bytes)          | Work per sample             |
+ * |---------------------|------------------------|-----------------------------|
+ * | filter_ema          | 6                      | add, subtract, shift        |
+ * | filter_ma           | 9 + 2 * 2^n history    | running sum, shift          |
+ * | filter_biquad       | 18                     | 5 multiplies, Q14 coeffs    |
+ * | filter_median       | 3 + 4 * FILTER_MEDIAN_MAX | one remove, one insert   |
+ *
+ * Samples are int16_t. ADC results (up to 16383 with oversampling)
+ * fit without scaling.
+ *
+ * The ATtiny85 has no hardware multiplier. The biquad multiplies a
+ * 16-bit sample by each coefficient one coefficient byte at a time,
+ * with an 8-step shift-and-add per byte. Cores that have MUL use it.
+ */
+
+#ifndef HAL_FILTER_H
+#define HAL_FILTER_H
+
+#include <stdint.h>
+
+/**
+ * @defgroup hal_filter Filters
+ * @brief Integer EMA, moving average, biquad and median filters
+ * @{
+ */
+
+/**
+ * @brief Largest median window
+ */
+#ifndef FILTER_MEDIAN_MAX
+#define FILTER_MEDIAN_MAX 9
+#endif
+
+/**
+ * @brief Convert a real constant to a Q14 biquad coefficient
+ *
+ * Q14 covers -2.0 to just under 2.0, which every stable a1 needs.
+ * Only use with constant expressions, so the conversion happens at
+ * compile time.
+ */
+#define FILTER_Q14(x) ((int16_t)((x) * 16384.0 + ((x) >= 0 ? 0.5 : -0.5)))
+
+/**
+ * @brief Exponential moving average, y += (x - y) / 2^shift
+ */
+typedef struct {
+    int32_t acc;        ///< y scaled by 2^shift
+    uint8_t shift;
+    uint8_t primed;
+} filter_ema_t;
+
+/**
+ * @brief Moving average over 2^log2_len samples
+ */
+typedef struct {
+    int16_t *buf;       ///< Caller-owned history, 2^log2_len entries
+    int32_t sum;
+    uint8_t pos;
+    uint8_t log2_len;
+    uint8_t primed;
+} filter_ma_t;
+
+/**
+ * @brief Biquad coefficients in Q14, a0 normalized to 1
+ *
+ * y = b0*x + b1*x1 + b2*x2 - a1*y1 - a2*y2
+ */
+typedef struct {
+    int16_t b0, b1, b2;
+    int16_t a1, a2;
+} filter_biquad_coeffs_t;
+
+/**
+ * @brief Direct form I biquad
+ */
+typedef struct {
+    filter_biquad_coeffs_t c;
+    int16_t x1, x2;
+    int16_t y1, y2;
+} filter_biquad_t;
+
+/**
+ * @brief Running median over N samples (odd, 3 to FILTER_MEDIAN_MAX)
+ */
+typedef struct {
+    int16_t hist[FILTER_MEDIAN_MAX];    ///< Samples in arrival order
+    int16_t sorted[FILTER_MEDIAN_MAX];  ///< The same samples, ascending
+    uint8_t n;
+    uint8_t pos;
+    uint8_t primed;
+} filter_median_t;
+
+/**
+ * @brief Create an EMA filter
+ *
+ * The first sample initializes the output, so there is no ramp from 0.
+ *
+ * @param shift Smoothing, alpha = 1 / 2^shift (1-15)
+ * @return Filter state
+ */
+filter_ema_t filter_ema_init(uint8_t shift);
+
+/**
+ * @brief Feed one sample to an EMA filter
+ *
+ * @param f Filter state
+ * @param x Input sample
+ * @return Filtered sample
+ */
+int16_t filter_ema(filter_ema_t *f, int16_t x);
+
+/**
+ * @brief Create a moving average filter
+ *
+ * @param buf History buffer with 2^log2_len entries
+ * @param log2_len Window length as a power of two (0-7)
+ * @return Filter state
+ */
+filter_ma_t filter_ma_init(int16_t *buf, uint8_t log2_len);
+
+/**
+ * @brief Feed one sample to a moving average filter
+ *
+ * Keeps a running sum, so the cost does not depend on the window.
+ *
+ * @param f Filter state
+ * @param x Input sample
+ * @return Mean of the last 2^log2_len samples
+ */
+int16_t filter_ma(filter_ma_t *f, int16_t x);
+
+/**
+ * @brief Create a biquad filter
+ *
+ * @param coeffs Q14 coefficients, copied
+ * @return Filter state
+ *
+ * @example
+ * @code
+ * // 2nd order Butterworth low-pass, fc = fs / 20
+ * static const filter_biquad_coeffs_t lp = {
+ *     .b0 = FILTER_Q14(0.020083), .b1 = FILTER_Q14(0.040167), .b2 = FILTER_Q14(0.020083),
+ *     .a1 = FILTER_Q14(-1.561018), .a2 = FILTER_Q14(0.641352)
+ * };
+ * filter_biquad_t bq = filter_biquad_init(&lp);
+ * @endcode
+ */
+filter_biquad_t filter_biquad_init(const filter_biquad_coeffs_t *coeffs);
+
+/**
+ * @brief Feed one sample to a biquad filter
+ *
+ * Products are summed in 32 bits and the output is rounded and
+ * saturated to int16_t.
+ *
+ * @param f Filter state
+ * @param x Input sample
+ * @return Filtered sample
+ */
+int16_t filter_biquad(filter_biquad_t *f, int16_t x);
+
+/**
+ * @brief Create a median filter
+ *
+ * @param n Window length, odd, 3 to FILTER_MEDIAN_MAX (clamped)
+ * @return Filter state
+ */
+filter_median_t filter_median_init(uint8_t n);
+
+/**
+ * @brief Feed one sample to a median filter
+ *
+ * Removes spikes shorter than half the window without smearing edges.
+ *
+ * @param f Filter state
+ * @param x Input sample
+ * @return Median of the last n samples
+ */
+int16_t filter_median(filter_median_t *f, int16_t x);
+
+/** @} */ // end of hal_filter
+
+#endif // HAL_FILTER_H
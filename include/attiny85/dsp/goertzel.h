@@ -0,0 +1,135 @@
+/**
+ * @file goertzel.h
+ * @brief Streaming Goertzel tone detector
+ *
+ * Measures the level of a few fixed frequencies in a sample stream
+ * without storing the samples. Each tone is a second order resonator
+ * that is updated as every sample arrives. At the end of each block of
+ * N samples, the resonator state is saved and the resonator is cleared.
+ * A tone costs 15 bytes of RAM, whatever the block length. A 256-point
+ * FFT would need more RAM than the ATtiny85 has.
+ *
+ * Coefficients are cos(2 pi f / fs) in Q15, computed by the compiler
+ * from constant frequencies through GOERTZEL_TONE(). Block results are
+ * read as amplitudes in input units. An on-bin tone
+ * x = A cos(2 pi f n / fs) reads as A.
+ *
+ * The ATtiny85 has no hardware multiplier. The per-sample update
+ * multiplies the 32-bit state by the coefficient with a 15-step
+ * shift-and-add, so the cost per tone per sample is fixed. Cores that
+ * have MUL use it.
+ *
+ * Choosing N: bins are fs / N wide. Tones closer together than about
+ * 2 fs / N are not separated. DTMF at fs = 4 kHz works with N = 100
+ * (40 Hz bins, 25 ms blocks).
+ */
+
+#ifndef HAL_GOERTZEL_H
+#define HAL_GOERTZEL_H
+
+#include <stdint.h>
+#include <math.h>
+
+/**
+ * @defgroup hal_goertzel Goertzel
+ * @brief Tone detection over blocks of streamed samples
+ * @{
+ */
+
+/**
+ * @brief cos(2 pi freq / rate), folded by the compiler for constants
+ */
+#define GOERTZEL_COS(freq, rate) cos(6.283185307179586 * (double)(freq) / (double)(rate))
+
+/**
+ * @brief Q15 coefficient for a tone at freq in a stream sampled at rate
+ *
+ * Only use with constant expressions. GCC folds cos() of constants, so
+ * neither libm nor floating point code ends up in the image. Clamped to
+ * +-32767 at both ends (0 Hz and fs / 2), so the magnitude fits the
+ * 15-bit multiply.
+ */
+#define GOERTZEL_Q15(freq, rate) \
+    ((int16_t)(GOERTZEL_COS(freq, rate) >= 32767.0 / 32768.0 ? 32767 : \
+               GOERTZEL_COS(freq, rate) <= -32767.0 / 32768.0 ? -32767 : \
+               GOERTZEL_COS(freq, rate) * 32768.0 + (GOERTZEL_COS(freq, rate) >= 0 ? 0.5 : -0.5)))
+
+/**
+ * @brief Initializer for one entry of a goertzel_tone_t array
+ *
+ * @example
+ * @code
+ * static goertzel_tone_t rows[] = {
+ *     GOERTZEL_TONE(697, 4000), GOERTZEL_TONE(770, 4000),
+ *     GOERTZEL_TONE(852, 4000), GOERTZEL_TONE(941, 4000)
+ * };
+ * @endcode
+ */
+#define GOERTZEL_TONE(freq, rate) { .coeff = GOERTZEL_Q15(freq, rate) }
+
+/**
+ * @brief One tone: resonator state and last block result
+ */
+typedef struct {
+    int16_t coeff;      ///< cos(2 pi f / fs), Q15
+    int32_t s1, s2;     ///< Resonator state for the current block
+    int16_t r1, r2;     ///< State at the end of the last block, scaled down
+    uint8_t r_shift;    ///< Scale of r1 and r2, as a left shift
+} goertzel_tone_t;
+
+/**
+ * @brief Tone detector handle
+ */
+typedef struct {
+    goertzel_tone_t *tones;     ///< Caller-owned tone array
+    uint8_t count;
+    uint16_t block_len;
+    uint16_t pos;               ///< Samples fed in the current block
+    volatile uint8_t seq;       ///< Completed blocks, wraps from 255 to 1
+} goertzel_t;
+
+/**
+ * @brief Create a tone detector
+ *
+ * Clears the state of every tone. Coefficients come from the array
+ * initializers (GOERTZEL_TONE) and are left untouched.
+ *
+ * @param tones Tone array, count entries
+ * @param count Number of tones
+ * @param block_len Samples per block (N), 2 or more
+ * @return Detector handle
+ */
+goertzel_t goertzel_init(goertzel_tone_t *tones, uint8_t count, uint16_t block_len);
+
+/**
+ * @brief Feed one sample to every tone
+ *
+ * Can be called from an ADC stream callback. Remove the DC level first
+ * (for example subtract 512 from a 10-bit result). A DC offset leaks
+ * into tones that are not on an exact bin.
+ *
+ * The state of a tone peaks near |x| * N / (2 sin(2 pi f / fs)) and
+ * must fit in 31 bits. Tones close to 0 or fs / 2 grow fastest. DTMF at
+ * 4 kHz with N = 100 and 10-bit samples stays below 2^17.
+ *
+ * @param g Detector handle
+ * @param x Sample without DC
+ * @return 1 if this sample completed a block, 0 otherwise
+ */
+uint8_t goertzel_feed(goertzel_t *g, int16_t x);
+
+/**
+ * @brief Read the amplitude of each tone in the last completed block
+ *
+ * Safe to call from the main loop while goertzel_feed() runs in an
+ * interrupt. All values are from the same block.
+ *
+ * @param g Detector handle
+ * @param amplitudes One entry per tone, in input units (saturated)
+ * @return Block sequence number, 0 before the first block completes
+ */
+uint8_t goertzel_read(goertzel_t *g, uint16_t *amplitudes);
+
+/** @} */ // end of hal_goertzel
+
+#endif // HAL_GOERTZEL_H
@@ -7,9 +7,13 @@
  *
  * Implementation:
  * - Uses USI Two-Wire mode (USIWM1=1, USIWM0=0)
- * - Software clock strobe via USITC bit for SCL generation
+ * - Software clock strobe via USITC bit for SCL generation, padded with
+ *   cycle-exact delays for 100 kHz, 400 kHz or 1 MHz
  * - USI 4-bit counter (USICNT) tracks bit transfers
  * - Automatic counter overflow detection (USIOIF flag)
+ * - Every wait on SCL (clock stretching) is bounded by timeout_us
+ * - A slave holding SDA low at START is cleared with up to 9 SCL
+ *   pulses and a STOP (bus recovery)
  *
  * Benefits over bitbanging:
  * - ~40-50% smaller code size
@@ -43,15 +47,37 @@ typedef enum {
     I2C_ERR_NACK,             ///< No acknowledge from slave
     I2C_ERR_BUS_ERROR,       ///< Bus error (arbitration, start, stop)
     I2C_ERR_TIMEOUT,          ///< Timeout waiting for slave
+    I2C_PENDING,              ///< Queued or in progress (i2c_async)
 } i2c_status_t;
 
+/**
+ * @brief I2C bus speed
+ *
+ * SCL low/high times are computed from F_CPU at compile time. The bit
+ * loop costs ~22 cycles per SCL period on top of the delays, which caps
+ * the rate at low F_CPU (see docs/attiny85.md for achieved rates).
+ */
+typedef enum {
+    I2C_SPEED_100K,     ///< Standard mode, 100 kHz
+    I2C_SPEED_400K,     ///< Fast mode, 400 kHz
+    I2C_SPEED_1M,       ///< Fast mode plus, 1 MHz (as fast as the loop runs)
+} i2c_speed_t;
+
+/**
+ * @brief SCL wait timeout used when i2c_config_t.timeout_us is 0
+ */
+#ifndef I2C_DEFAULT_TIMEOUT_US
+#define I2C_DEFAULT_TIMEOUT_US 1000
+#endif
+
 /**
  * @brief I2C configuration
  */
 typedef struct {
     uint8_t sda_pin;
     uint8_t scl_pin;
-    uint32_t timeout_us;
+    uint32_t timeout_us;        ///< Max time a slave may hold SCL low (0: default)
+    i2c_speed_t speed;          ///< Bus speed
 } i2c_config_t;
 
 /**
@@ -59,6 +85,7 @@ typedef struct {
  */
 typedef struct {
     i2c_config_t config;
+    uint16_t scl_timeout;       ///< timeout_us as SCL poll iterations
 } i2c_t;
 
 /**
@@ -74,11 +101,25 @@ i2c_t i2c_init(i2c_config_t config);
 /**
  * @brief Start I2C transaction (START condition)
  *
+ * Runs i2c_recover() first if a slave is holding SDA low.
+ *
  * @param i2c I2C handle
  * @return I2C status
  */
 i2c_status_t i2c_start(i2c_t *i2c);
 
+/**
+ * @brief Recover a stuck bus
+ *
+ * Releases both lines, clocks SCL up to 9 times until the slave lets
+ * go of SDA, then issues a STOP.
+ *
+ * @param i2c I2C handle
+ * @return I2C_OK, I2C_ERR_TIMEOUT if SCL stays low, or
+ *         I2C_ERR_BUS_ERROR if SDA is still low after 9 clocks
+ */
+i2c_status_t i2c_recover(i2c_t *i2c);
+
 /**
  * @brief Send I2C STOP condition
  *
@@ -124,6 +165,55 @@ i2c_status_t i2c_read_byte(i2c_t *i2c, uint8_t *data);
  */
 i2c_status_t i2c_address(i2c_t *i2c, uint8_t address, uint8_t read_write);
 
+/**
+ * @brief Write bytes, then read bytes, in one transaction
+ *
+ * START, address+W, tx bytes, repeated START, address+R, rx bytes with
+ * the last one NACKed, STOP. With tx_len 0 only the read part runs, with
+ * rx_len 0 only the write part.
+ *
+ * @param i2c I2C handle
+ * @param address Slave address (7-bit)
+ * @param tx Bytes to write
+ * @param tx_len Number of bytes to write
+ * @param rx Buffer for read bytes
+ * @param rx_len Number of bytes to read
+ * @return I2C status
+ */
+i2c_status_t i2c_write_read(i2c_t *i2c, uint8_t address, const uint8_t *tx, uint8_t tx_len,
+                            uint8_t *rx, uint8_t rx_len);
+
+/**
+ * @brief Read consecutive registers in one burst
+ *
+ * @param i2c I2C handle
+ * @param address Slave address (7-bit)
+ * @param reg First register address
+ * @param data Buffer for len bytes
+ * @param len Number of registers to read
+ * @return I2C status
+ *
+ * @example
+ * @code
+ * uint8_t raw[6];
+ * i2c_read_regs(&i2c, 0x68, 0x3B, raw, 6);   // accel X/Y/Z in one go
+ * @endcode
+ */
+i2c_status_t i2c_read_regs(i2c_t *i2c, uint8_t address, uint8_t reg, uint8_t *data, uint8_t len);
+
+/**
+ * @brief Write consecutive registers in one burst
+ *
+ * @param i2c I2C handle
+ * @param address Slave address (7-bit)
+ * @param reg First register address
+ * @param data Bytes to write
+ * @param len Number of registers to write
+ * @return I2C status
+ */
+i2c_status_t i2c_write_regs(i2c_t *i2c, uint8_t address, uint8_t reg, const uint8_t *data,
+                            uint8_t len);
+
 /**
  * @brief Read from register
  *
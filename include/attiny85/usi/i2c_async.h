@@ -0,0 +1,143 @@
+/**
+ * @file i2c_async.h
+ * @brief Interrupt-driven USI I2C master queue for ATtiny85
+ *
+ * Runs I2C transactions in the background so the main loop and other
+ * interrupts keep running while the bus is busy.
+ *
+ * Implementation:
+ * - Timer0 in CTC mode fires once per SCL half period; its compare ISR
+ *   strobes USITC during a byte and steps through START, repeated START
+ *   and STOP conditions between bytes
+ * - The USI counter overflow interrupt ends each byte and ACK bit and
+ *   sets up the next one
+ * - Transactions are caller-owned descriptors linked into a FIFO, so the
+ *   queue needs no RAM of its own and has no length limit
+ * - Clock stretching holds the state machine; a slave holding SCL low
+ *   longer than timeout_us ends the transaction with I2C_ERR_TIMEOUT
+ *
+ * Timing:
+ * - Each SCL half period costs one Timer0 ISR (~50 cycles with the
+ *   state dispatch), so the half period is never shorter than
+ *   I2C_ASYNC_MIN_HALF_CYCLES. At 16 MHz the bus tops out near 125 kHz
+ *   whatever speed is configured; i2c_async_init() returns the rate it
+ *   actually runs at. Use the blocking API for 400 kHz+.
+ *
+ * Hardware:
+ * - SCL: PB2 (pin 7)
+ * - SDA: PB0 (pin 5)
+ *
+ * @note Owns TIMER0_COMPA_vect and USI_OVF_vect and cannot be linked
+ *       together with the USI SPI master interrupt engine (spi_async.c), the
+ *       USI SPI slave (spi_slave.c) or the USI I2C slave (i2c_slave.c).
+ *       Timer0 PWM is unavailable while a transaction is queued.
+ */
+
+#ifndef HAL_USI_I2C_ASYNC_H
+#define HAL_USI_I2C_ASYNC_H
+
+#include <stdint.h>
+#include "attiny85/usi/i2c.h"
+
+/**
+ * @defgroup hal_usi_i2c_async USI I2C Async Master
+ * @brief Queued, interrupt-driven USI I2C transactions
+ * @{
+ */
+
+/**
+ * @brief Shortest SCL half period in CPU cycles
+ *
+ * Must cover the Timer0 compare ISR, otherwise compare matches are lost
+ * and SCL runs irregularly.
+ */
+#ifndef I2C_ASYNC_MIN_HALF_CYCLES
+#define I2C_ASYNC_MIN_HALF_CYCLES 64
+#endif
+
+struct i2c_xfer;
+
+/**
+ * @brief Transaction completion callback
+ *
+ * Called from interrupt context once the STOP has been sent, after the
+ * next queued transaction has been started.
+ *
+ * @param xfer The finished transaction, status filled in
+ */
+typedef void (*i2c_xfer_callback_t)(struct i2c_xfer *xfer);
+
+/**
+ * @brief Transaction descriptor
+ *
+ * START, address+W and the write segment, then a repeated START,
+ * address+R and the read segment (last byte NACKed), then STOP. Either
+ * segment may be empty. The descriptor and both buffers must stay valid
+ * until status is no longer I2C_PENDING.
+ */
+typedef struct i2c_xfer {
+    uint8_t address;                    ///< Slave address (7-bit)
+    const uint8_t *tx;                  ///< Write segment
+    uint8_t tx_len;                     ///< Write segment length
+    uint8_t *rx;                        ///< Read segment
+    uint8_t rx_len;                     ///< Read segment length
+    i2c_xfer_callback_t callback;       ///< Completion callback (can be NULL)
+    volatile i2c_status_t status;       ///< I2C_PENDING until finished
+    struct i2c_xfer *next;              ///< Queue link (driver use)
+} i2c_xfer_t;
+
+/**
+ * @brief Set up the interrupt-driven engine on an I2C bus
+ *
+ * Derives the Timer0 period from i2c->config.speed and the clock
+ * stretching limit from i2c->config.timeout_us. Speeds that need a
+ * half period shorter than I2C_ASYNC_MIN_HALF_CYCLES run at that
+ * limit instead, so 400K and 1M give about 125 kHz at 16 MHz.
+ *
+ * @param i2c I2C handle from i2c_init()
+ * @return Effective SCL frequency in Hz, before clock stretching
+ *
+ * @note Requires global interrupts enabled
+ */
+uint32_t i2c_async_init(i2c_t *i2c);
+
+/**
+ * @brief Queue a transaction
+ *
+ * Starts it right away if the bus is idle. Returns immediately; poll
+ * xfer->status or use the callback.
+ *
+ * @param i2c I2C handle
+ * @param xfer Transaction descriptor, must not already be queued
+ *
+ * @example
+ * @code
+ * static uint8_t reg = 0x3B;
+ * static uint8_t raw[6];
+ * static i2c_xfer_t xfer = {
+ *     .address = 0x68,
+ *     .tx = &reg, .tx_len = 1,
+ *     .rx = raw, .rx_len = 6
+ * };
+ *
+ * i2c_async_submit(&i2c, &xfer);
+ * while (xfer.status == I2C_PENDING) {
+ *     // other work
+ * }
+ * @endcode
+ */
+void i2c_async_submit(i2c_t *i2c, i2c_xfer_t *xfer);
+
+/**
+ * @brief Check if any transaction is queued or running
+ *
+ * The blocking i2c_* functions must not be used while this is non-zero.
+ *
+ * @param i2c I2C handle
+ * @return Non-zero if busy
+ */
+uint8_t i2c_async_is_busy(i2c_t *i2c);
+
+/** @} */ // end of hal_usi_i2c_async
+
+#endif // HAL_USI_I2C_ASYNC_H
@@ -0,0 +1,136 @@
+/**
+ * @file i2c_slave.h
+ * @brief Interrupt-driven USI I2C slave with a register map for ATtiny85
+ *
+ * Turns the ATtiny85 into an I2C peripheral (port expander, sensor
+ * front-end) that exposes a RAM array as a bank of registers.
+ *
+ * Implementation:
+ * - USI Two-Wire mode clocked by the master on SCL
+ * - Start condition interrupt arms the state machine; the counter
+ *   overflow interrupt handles address, data and ACK phases
+ * - The USI holds SCL low from each overflow until USISR is rewritten,
+ *   which every ISR path does first, before any bookkeeping
+ * - Register map protocol: the first byte of a write sets the register
+ *   pointer, later bytes are stored there; reads return registers from
+ *   the pointer. The pointer auto-increments and wraps at the map size.
+ * - Per-register write masks make registers (or single bits) read-only
+ *
+ * Timing:
+ * - Each overflow stretches SCL for the ISR entry plus a few
+ *   instructions (~2 us at 16 MHz), twice per byte. See docs/attiny85.md.
+ *
+ * Hardware:
+ * - SCL: PB2 (pin 7)
+ * - SDA: PB0 (pin 5)
+ *
+ * @note Owns USI_START_vect and USI_OVF_vect and cannot be linked together
+ *       with the USI SPI slave, the USI SPI master interrupt engine (spi_async.c) or
+ *       the USI I2C async master
+ *
+ * Based on: AVR312 Application Note - Using the USI module as a I2C slave
+ */
+
+#ifndef HAL_USI_I2C_SLAVE_H
+#define HAL_USI_I2C_SLAVE_H
+
+#include <stdint.h>
+
+/**
+ * @defgroup hal_usi_i2c_slave USI I2C Slave
+ * @brief Interrupt-driven USI I2C slave with register map
+ * @{
+ */
+
+/**
+ * @brief Longest wait in the start interrupt for SCL to fall after SDA
+ *
+ * A bus that holds SCL high and SDA low for longer is not followed; the
+ * slave goes back to waiting for the next START.
+ */
+#ifndef I2C_SLAVE_START_TIMEOUT_US
+#define I2C_SLAVE_START_TIMEOUT_US 1000
+#endif
+
+/**
+ * @brief Write-complete callback
+ *
+ * Called from i2c_slave_poll() after a master write has ended with a
+ * STOP or repeated START. Writes that end before the next poll are
+ * merged into one range.
+ *
+ * @param reg First register written
+ * @param count Number of registers from reg that may have changed
+ */
+typedef void (*i2c_slave_write_callback_t)(uint8_t reg, uint8_t count);
+
+/**
+ * @brief I2C slave configuration
+ */
+typedef struct {
+    uint8_t address;                        ///< Own 7-bit address
+    uint8_t *regs;                          ///< Register map in RAM
+    const uint8_t *write_mask;              ///< Writable bits per register (NULL: all)
+    uint8_t size;                           ///< Number of registers (1-255)
+    i2c_slave_write_callback_t on_write;    ///< Write-complete callback (can be NULL)
+} i2c_slave_config_t;
+
+/**
+ * @brief I2C slave handle
+ */
+typedef struct {
+    i2c_slave_config_t config;
+} i2c_slave_t;
+
+/**
+ * @brief Initialize USI I2C slave
+ *
+ * Releases SDA and SCL (external pull-ups required) and enables the
+ * start condition interrupt.
+ *
+ * @param config I2C slave configuration
+ * @return I2C slave handle
+ *
+ * @note Requires global interrupts enabled
+ *
+ * @example
+ * @code
+ * static uint8_t regs[4];
+ * static const uint8_t mask[4] = {0xFF, 0xFF, 0x00, 0x00};  // 2, 3 read-only
+ *
+ * i2c_slave_config_t config = {
+ *     .address = 0x20,
+ *     .regs = regs,
+ *     .write_mask = mask,
+ *     .size = sizeof(regs),
+ *     .on_write = regs_written
+ * };
+ * i2c_slave_t slave = i2c_slave_init(config);
+ *
+ * while (1) {
+ *     i2c_slave_poll(&slave);
+ * }
+ * @endcode
+ */
+i2c_slave_t i2c_slave_init(i2c_slave_config_t config);
+
+/**
+ * @brief Disable USI I2C slave
+ *
+ * @param slave I2C slave handle
+ */
+void i2c_slave_deinit(i2c_slave_t *slave);
+
+/**
+ * @brief Run the write-complete callback if a master write has ended
+ *
+ * Call from the main loop. The USI has no STOP interrupt, so the end of
+ * a write is picked up here.
+ *
+ * @param slave I2C slave handle
+ */
+void i2c_slave_poll(i2c_slave_t *slave);
+
+/** @} */ // end of hal_usi_i2c_slave
+
+#endif // HAL_USI_I2C_SLAVE_H
@@ -11,6 +11,15 @@
  * - USI 4-bit counter (USICNT) tracks clock edges
  * - Automatic counter overflow detection (USIOIF flag)
  * - Atomic block for consistent timing during transfers
+ * - LSB-first by reversing each byte through a flash lookup table
+ *   (see util/bitrev.h), since the USI shifts MSB first only
+ *
+ * Clock generation:
+ * - SPI_CLK_DIV2: unrolled strobe sequence, one SCK edge per CPU cycle
+ * - SPI_CLK_DIV8: strobe loop polling USIOIF
+ * - SPI_CLK_DIV64 and slower: Timer0 CTC compare match strobes USITC
+ *   from an interrupt, USI counter overflow interrupt completes each
+ *   byte. The CPU is free between edges.
  *
  * Benefits over bitbanging:
  * - ~40-50% smaller code size
@@ -45,8 +54,8 @@
 typedef enum {
     SPI_MODE_0,    ///< CPOL=0, CPHA=0 (sample on rising edge, shift on falling)
     SPI_MODE_1,    ///< CPOL=0, CPHA=1 (sample on falling edge, shift on rising)
-    SPI_MODE_2,    ///< CPOL=1, CPHA=0 (sample on rising edge, shift on falling)
-    SPI_MODE_3,    ///< CPOL=1, CPHA=1 (sample on falling edge, shift on rising)
+    SPI_MODE_2,    ///< CPOL=1, CPHA=0 (sample on falling edge, shift on rising)
+    SPI_MODE_3,    ///< CPOL=1, CPHA=1 (sample on rising edge, shift on falling)
 } spi_mode_t;
 
 /**
@@ -57,6 +66,25 @@ typedef enum {
     SPI_BIT_ORDER_LSB_FIRST,    ///< LSB transmitted first
 } spi_bit_order_t;
 
+/**
+ * @brief SPI clock divisor
+ *
+ * SCK = F_CPU / divisor. DIV2 and DIV8 are generated by the CPU and
+ * block until the byte is done. DIV64 and slower are clocked by Timer0
+ * compare match interrupts and leave the CPU free between edges.
+ *
+ * @note The Timer0-clocked rates take over Timer0 while a transfer runs
+ */
+typedef enum {
+    SPI_CLK_DIV2,      ///< F_CPU / 2 (unrolled strobe, polled)
+    SPI_CLK_DIV8,      ///< F_CPU / 8 (strobe loop, polled)
+    SPI_CLK_DIV64,     ///< F_CPU / 64 (Timer0 compare, interrupt-driven)
+    SPI_CLK_DIV128,    ///< F_CPU / 128 (Timer0 compare, interrupt-driven)
+    SPI_CLK_DIV256,    ///< F_CPU / 256 (Timer0 compare, interrupt-driven)
+    SPI_CLK_DIV1024,   ///< F_CPU / 1024 (Timer0 compare, interrupt-driven)
+    SPI_CLK_DIV4096,   ///< F_CPU / 4096 (Timer0 compare, interrupt-driven)
+} spi_clock_t;
+
 /**
  * @brief SPI configuration
  */
@@ -66,15 +94,54 @@ typedef struct {
     uint8_t miso_pin;
     spi_mode_t mode;
     spi_bit_order_t bit_order;
+    spi_clock_t clock;
 } spi_config_t;
 
+/**
+ * @brief SPI device on a shared bus
+ *
+ * Describes one slave: its chip select pin and the bus settings it needs.
+ * spi_device_init() precomputes the register values so that switching
+ * between devices costs a handful of register writes.
+ */
+typedef struct {
+    uint8_t cs_pin;             ///< Chip select pin (active low)
+    spi_mode_t mode;
+    spi_bit_order_t bit_order;
+    spi_clock_t clock;
+    uint8_t usicr;              ///< Cached USICR strobe value
+    uint8_t timer_prescaler;    ///< Cached Timer0 clock select
+    uint8_t timer_top;          ///< Cached Timer0 OCR0A
+} spi_device_t;
+
+/**
+ * @brief One tx/rx segment of a transaction
+ */
+typedef struct {
+    const uint8_t *tx;          ///< Bytes to transmit (NULL sends 0xFF)
+    uint8_t *rx;                ///< Received bytes (NULL discards)
+    uint16_t len;               ///< Number of bytes
+} spi_segment_t;
+
 /**
  * @brief SPI handle
  */
 typedef struct {
     spi_config_t config;
+    uint8_t usicr;              ///< USICR value that strobes one SCK edge
+    uint8_t timer_prescaler;    ///< Timer0 clock select for interrupt-driven rates
+    uint8_t timer_top;          ///< Timer0 OCR0A for interrupt-driven rates
+    const spi_device_t *device; ///< Device whose settings are active (NULL after spi_init)
 } spi_t;
 
+/**
+ * @brief Transfer completion callback
+ *
+ * Called from the USI overflow interrupt when an asynchronous transfer
+ * has finished.
+ */
+typedef void (*spi_callback_t)(void);
+
 /**
  * @brief Initialize USI SPI master
  *
@@ -101,10 +168,11 @@ uint8_t spi_transfer(spi_t *spi, uint8_t data);
 /**
  * @brief Transfer buffer
  *
- * Transmits buffer and receives response.
+ * Transmits buffer and receives response. Blocks until done; the
+ * Timer0-clocked rates poll the compare flag, so no interrupt is used.
  *
  * @param spi SPI handle
- * @param tx Buffer to transmit
+ * @param tx Buffer to transmit (NULL sends 0xFF)
  * @param rx Buffer to receive (can be NULL for write-only)
  * @param len Number of bytes
  */
@@ -119,6 +187,77 @@ void spi_transfer_buf(spi_t *spi, const uint8_t *tx, uint8_t *rx, uint16_t len);
  */
 void spi_write(spi_t *spi, const uint8_t *data, uint16_t len);
 
+/**
+ * @brief Start an interrupt-driven transfer
+ *
+ * Starts clocking the buffer out and returns immediately. Each SCK edge
+ * is generated by the Timer0 compare match interrupt and each completed
+ * byte by the USI counter overflow interrupt. Waits for a previous
+ * transfer to finish before starting.
+ *
+ * @param spi SPI handle
+ * @param tx Buffer to transmit (NULL sends 0xFF)
+ * @param rx Buffer to receive (can be NULL for write-only)
+ * @param len Number of bytes
+ * @param callback Called from interrupt context when done (can be NULL)
+ *
+ * @note Buffers must stay valid until the transfer is complete
+ * @note With SPI_CLK_DIV2/SPI_CLK_DIV8 the transfer runs to completion
+ *       before returning
+ * @note Defined in spi_async.c together with TIMER0_COMPA_vect and
+ *       USI_OVF_vect, which are only linked in when this is called
+ * @note Requires global interrupts enabled for Timer0-clocked rates
+ */
+void spi_transfer_async(spi_t *spi, const uint8_t *tx, uint8_t *rx, uint16_t len,
+                        spi_callback_t callback);
+
+/**
+ * @brief Initialize an SPI device
+ *
+ * Configures the chip select pin as output (deasserted) and caches the
+ * register values for the device's mode and clock.
+ *
+ * @param spi SPI bus handle
+ * @param dev Device with cs_pin, mode, bit_order and clock filled in
+ *
+ * @note Call again after changing any device field
+ */
+void spi_device_init(spi_t *spi, spi_device_t *dev);
+
+/**
+ * @brief Run a transaction on a device
+ *
+ * Applies the device settings if a different device was used last,
+ * asserts chip select, runs each segment in order and deasserts chip
+ * select. Blocks until all segments are done.
+ *
+ * @param spi SPI bus handle
+ * @param dev Device to talk to
+ * @param segments Array of tx/rx segments
+ * @param count Number of segments
+ *
+ * @example
+ * @code
+ * uint8_t cmd[4] = {0x03, 0x00, 0x10, 0x00};
+ * uint8_t data[16];
+ * spi_segment_t segs[] = {
+ *     { .tx = cmd, .rx = NULL, .len = sizeof(cmd) },
+ *     { .tx = NULL, .rx = data, .len = sizeof(data) },
+ * };
+ * spi_transaction(&spi, &flash, segs, 2);
+ * @endcode
+ */
+void spi_transaction(spi_t *spi, const spi_device_t *dev, const spi_segment_t *segments,
+                     uint8_t count);
+
+/**
+ * @brief Check if an asynchronous transfer is in progress
+ *
+ * @param spi SPI handle
+ * @return Non-zero if transfer in progress
+ */
+uint8_t spi_is_busy(spi_t *spi);
+
 /** @} */ // end of hal_usi_spi
 
 #endif // HAL_USI_SPI_H
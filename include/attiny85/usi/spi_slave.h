@@ -0,0 +1,165 @@
+/**
+ * @file spi_slave.h
+ * @brief Interrupt-driven USI SPI slave for ATtiny85
+ *
+ * Turns the ATtiny85 into an SPI peripheral behind a host MCU.
+ *
+ * Implementation:
+ * - USI Three-Wire mode clocked by the host on USCK
+ * - Chip select on any free PORTB pin via pin change interrupt
+ * - USI counter overflow interrupt completes each byte
+ * - Double-buffered responses: the overflow ISR writes a byte that was
+ *   prepared one byte earlier into USIDR before doing anything else,
+ *   then prepares the following one
+ * - Response source is either a TX ring or a per-byte callback
+ *   (register map, command parser)
+ *
+ * Timing:
+ * - The USIDR reload happens 11 cycles after the overflow is flagged,
+ *   which must fit in half an SCK period between two bytes
+ * - The whole ISR, including the callback, must fit in one byte time
+ * - See docs/attiny85.md for the maximum host clock per F_CPU
+ *
+ * Hardware:
+ * - MOSI: PB0 (pin 5) - USI DI
+ * - MISO: PB1 (pin 6) - USI DO (driven only while selected)
+ * - SCK:  PB2 (pin 7) - USI USCK
+ * - CS:   any other PORTB pin, active low
+ *
+ * @note Owns USI_OVF_vect and cannot be linked together with the USI
+ *       SPI master interrupt engine (spi_async.c)
+ *
+ * Based on: AVR319 Application Note - Using USI for SPI Communication
+ */
+
+#ifndef HAL_USI_SPI_SLAVE_H
+#define HAL_USI_SPI_SLAVE_H
+
+#include <stdint.h>
+#include "attiny85/gpio/gpio.h"
+#include "attiny85/usi/spi.h"
+
+/**
+ * @defgroup hal_usi_spi_slave USI SPI Slave
+ * @brief Interrupt-driven USI SPI slave
+ * @{
+ */
+
+/**
+ * @brief RX ring size in bytes (power of two)
+ */
+#ifndef SPI_SLAVE_RX_SIZE
+#define SPI_SLAVE_RX_SIZE 16
+#endif
+
+/**
+ * @brief TX ring size in bytes (power of two)
+ */
+#ifndef SPI_SLAVE_TX_SIZE
+#define SPI_SLAVE_TX_SIZE 16
+#endif
+
+/**
+ * @brief Per-byte callback
+ *
+ * Called from the USI overflow interrupt after each received byte.
+ * The returned byte is transmitted two byte slots later (slot index + 2),
+ * because the byte for slot index + 1 is already in USIDR when the
+ * callback runs. The first two slots of a frame transmit 0xFF.
+ *
+ * @param index Position of the received byte in the current frame
+ * @param data Received byte
+ * @return Byte to transmit in slot index + 2
+ */
+typedef uint8_t (*spi_slave_byte_callback_t)(uint8_t index, uint8_t data);
+
+/**
+ * @brief End-of-frame callback
+ *
+ * Called from the pin change interrupt when CS is released, after the
+ * last byte of the frame has been stored.
+ *
+ * @param length Number of bytes clocked during the frame
+ */
+typedef void (*spi_slave_frame_callback_t)(uint8_t length);
+
+/**
+ * @brief SPI slave configuration
+ */
+typedef struct {
+    gpio_pin_t cs_pin;                      ///< Chip select pin (active low)
+    spi_mode_t mode;                        ///< SPI mode used by the host
+    spi_slave_byte_callback_t on_byte;      ///< Per-byte callback (NULL: RX/TX rings)
+    spi_slave_frame_callback_t on_frame;    ///< End-of-frame callback (can be NULL)
+} spi_slave_config_t;
+
+/**
+ * @brief SPI slave handle
+ */
+typedef struct {
+    spi_slave_config_t config;
+} spi_slave_t;
+
+/**
+ * @brief Initialize USI SPI slave
+ *
+ * Configures the USI pins, chip select pin change interrupt and the
+ * USI overflow interrupt. MISO stays tri-stated until CS is asserted.
+ *
+ * @param config SPI slave configuration
+ * @return SPI slave handle
+ *
+ * @note Requires global interrupts enabled
+ * @note The host must leave ~5 us between asserting CS and the first
+ *       SCK edge for the pin change interrupt to arm the USI
+ */
+spi_slave_t spi_slave_init(spi_slave_config_t config);
+
+/**
+ * @brief Disable USI SPI slave
+ *
+ * @param slave SPI slave handle
+ */
+void spi_slave_deinit(spi_slave_t *slave);
+
+/**
+ * @brief Number of received bytes waiting in the RX ring
+ *
+ * @param slave SPI slave handle
+ * @return Number of bytes available
+ */
+uint8_t spi_slave_available(spi_slave_t *slave);
+
+/**
+ * @brief Read a byte from the RX ring
+ *
+ * @param slave SPI slave handle
+ * @param data Pointer to store received byte
+ * @return Non-zero if a byte was read
+ */
+uint8_t spi_slave_read(spi_slave_t *slave, uint8_t *data);
+
+/**
+ * @brief Queue a response byte in the TX ring
+ *
+ * Slots with no queued byte transmit 0xFF. A byte leaves the ring only
+ * once it has been clocked out; bytes already handed to the USI when CS
+ * is released go out in the next frame.
+ *
+ * @param slave SPI slave handle
+ * @param data Byte to transmit
+ * @return Non-zero if the byte was queued, zero if the ring is full
+ */
+uint8_t spi_slave_write(spi_slave_t *slave, uint8_t data);
+
+/**
+ * @brief Get and clear the RX overrun count
+ *
+ * @param slave SPI slave handle
+ * @return Number of bytes dropped because the RX ring was full
+ */
+uint8_t spi_slave_overruns(spi_slave_t *slave);
+
+/** @} */ // end of hal_usi_spi_slave
+
+#endif // HAL_USI_SPI_SLAVE_H
@@ -0,0 +1,81 @@
+/**
+ * @file bitrev.h
+ * @brief Table-driven bit reversal
+ *
+ * The USI only shifts MSB first, so LSB-first protocols need every byte
+ * reversed on the way in and out. Two flash-resident lookup tables are
+ * provided:
+ *
+ * | Variant             | Flash     | Cycles (approx.) |
+ * |---------------------|-----------|------------------|
+ * | hal_bitrev8_table   | 256 bytes | 7                |
+ * | hal_bitrev8_nibble  | 16 bytes  | 20               |
+ * | shift loop (ref.)   | -         | ~40              |
+ *
+ * hal_bitrev8() picks one at compile time via HAL_BITREV_TABLE_SIZE.
+ * Only the table that is referenced ends up in the image.
+ */
+
+#ifndef HAL_BITREV_H
+#define HAL_BITREV_H
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+/**
+ * @defgroup hal_bitrev Bit Reversal
+ * @brief Byte bit-order reversal via lookup tables
+ * @{
+ */
+
+/**
+ * @brief Table used by hal_bitrev8(): 256 (speed) or 16 (flash)
+ */
+#ifndef HAL_BITREV_TABLE_SIZE
+#define HAL_BITREV_TABLE_SIZE 16
+#endif
+
+extern const uint8_t hal_bitrev_table[256] PROGMEM;
+extern const uint8_t hal_bitrev_nibble_table[16] PROGMEM;
+
+/**
+ * @brief Reverse a byte with the 256-entry table
+ *
+ * @param data Byte to reverse
+ * @return data with bit 0 and bit 7 swapped, bit 1 and bit 6, ...
+ */
+static inline uint8_t hal_bitrev8_table(uint8_t data) {
+    return pgm_read_byte(&hal_bitrev_table[data]);
+}
+
+/**
+ * @brief Reverse a byte with the 16-entry nibble table
+ *
+ * @param data Byte to reverse
+ * @return Reversed byte
+ */
+static inline uint8_t hal_bitrev8_nibble(uint8_t data) {
+    uint8_t lo = pgm_read_byte(&hal_bitrev_nibble_table[data & 0x0F]);
+    uint8_t hi = pgm_read_byte(&hal_bitrev_nibble_table[data >> 4]);
+    return (uint8_t)(lo << 4) | hi;
+}
+
+/**
+ * @brief Reverse a byte with the table selected by HAL_BITREV_TABLE_SIZE
+ *
+ * @param data Byte to reverse
+ * @return Reversed byte
+ */
+static inline uint8_t hal_bitrev8(uint8_t data) {
+#if HAL_BITREV_TABLE_SIZE == 256
+    return hal_bitrev8_table(data);
+#elif HAL_BITREV_TABLE_SIZE == 16
+    return hal_bitrev8_nibble(data);
+#else
+#error "HAL_BITREV_TABLE_SIZE must be 16 or 256"
+#endif
+}
+
+/** @} */ // end of hal_bitrev
+
+#endif // HAL_BITREV_H
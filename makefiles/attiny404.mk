@@ -52,18 +52,22 @@ LIB_NAME = libattiny404.a
 # Source Files (ATtiny404)
 # ============================================================================
 SOURCES = $(SRC_DIR)/attiny404/gpio/gpio.c \
+          $(SRC_DIR)/attiny404/gpio/gpio_pcint.c \
           $(SRC_DIR)/attiny404/timer/tca0.c \
           $(SRC_DIR)/attiny404/timer/tcb0.c \
           $(SRC_DIR)/attiny404/adc/adc.c \
           $(SRC_DIR)/attiny404/usart/usart.c \
           $(SRC_DIR)/attiny404/twi/twi.c \
-          $(SRC_DIR)/attiny404/spi/spi.c
+          $(SRC_DIR)/attiny404/twi/twi_client.c \
+          $(SRC_DIR)/attiny404/spi/spi.c \
+          $(SRC_DIR)/attiny404/spi/spi_async.c \
+          $(SRC_DIR)/attiny404/spi/spi_slave.c
 
 # Object files
 OBJECTS = $(SOURCES:$(SRC_DIR)/%.c=$(BUILD_DIR)/%.o)
 
 # Examples
-EXAMPLES = blink_led uart_demo adc_read spi_demo twi_scan
+EXAMPLES = blink_led uart_demo adc_read spi_demo twi_scan spi_bench spi_slave_bench twi_client_bench
 
 # Example objects
 EXAMPLE_OBJECTS = $(EXAMPLES:%=$(BUILD_DIR)/%.o)
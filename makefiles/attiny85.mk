@@ -29,6 +29,7 @@ CFLAGS += -fdata-sections      # Separate data into sections
 CFLAGS += -ffunction-sections  # Separate functions into sections
 CFLAGS += -Iinclude            # Include path
 CFLAGS += -Iinclude/attiny85/adc
+CFLAGS += -Iinclude/attiny85/dsp
 CFLAGS += -Iinclude/attiny85/eeprom
 CFLAGS += -Iinclude/attiny85/gpio
 CFLAGS += -Iinclude/attiny85/power
@@ -47,6 +48,7 @@ LDFLAGS += -Wl,--gc-sections  # Remove unused sections
 SRC_DIR = src
 INCLUDE_DIR = include
 BUILD_DIR = build
+EXAMPLES_DIR = examples/attiny85
 
 # ============================================================================
 # Source Files (Phase 1-3)
@@ -57,8 +59,15 @@ SOURCES = $(SRC_DIR)/attiny85/gpio/gpio.c \
           $(SRC_DIR)/attiny85/power/power.c \
           $(SRC_DIR)/attiny85/eeprom/eeprom.c \
           $(SRC_DIR)/attiny85/usi/spi.c \
+          $(SRC_DIR)/attiny85/usi/spi_async.c \
+          $(SRC_DIR)/attiny85/usi/spi_slave.c \
           $(SRC_DIR)/attiny85/usi/i2c.c \
-          $(SRC_DIR)/attiny85/uart/uart.c
+          $(SRC_DIR)/attiny85/usi/i2c_async.c \
+          $(SRC_DIR)/attiny85/usi/i2c_slave.c \
+          $(SRC_DIR)/attiny85/uart/uart.c \
+          $(SRC_DIR)/attiny85/util/bitrev.c \
+          $(SRC_DIR)/attiny85/dsp/filter.c \
+          $(SRC_DIR)/attiny85/dsp/goertzel.c
 
 # ============================================================================
 # Object Files and Library
@@ -66,10 +75,20 @@ SOURCES = $(SRC_DIR)/attiny85/gpio/gpio.c \
 OBJECTS = $(SOURCES:$(SRC_DIR)/%.c=$(BUILD_DIR)/%.o)
 LIB = $(BUILD_DIR)/libattiny85.a
 
+# Examples
+EXAMPLES = spi_slave_bench \
+           bitrev_bench \
+           i2c_slave_bench \
+           adc_oversample_bench \
+           filter_bench \
+           goertzel_bench
+
+EXAMPLE_HEXS = $(EXAMPLES:%=$(BUILD_DIR)/%.hex)
+
 # ============================================================================
 # Default Target
 # ============================================================================
-all: $(LIB)
+all: $(LIB) examples
 
 # ============================================================================
 # Create Build Directory
@@ -91,6 +110,33 @@ $(BUILD_DIR)/%.o: $(SRC_DIR)/%.c
 $(LIB): $(OBJECTS)
 	@$(AR) rcs $@ $^
 
+# ============================================================================
+# Build Examples
+# ============================================================================
+examples: $(EXAMPLE_HEXS)
+.PHONY: examples
+
+$(BUILD_DIR)/%.o: $(EXAMPLES_DIR)/%.c $(LIB)
+	@mkdir -p $(dir $@)
+	@echo "  CC    $<"
+	@$(CC) $(CFLAGS) -c $< -o $@
+
+$(BUILD_DIR)/%.elf: $(BUILD_DIR)/%.o $(LIB)
+	@echo "  LD    $*.elf"
+	@$(CC) $(CFLAGS) -L$(BUILD_DIR) $< -lattiny85 $(LDFLAGS) -o $@
+
+$(BUILD_DIR)/%.hex: $(BUILD_DIR)/%.elf
+	@echo "  HEX   $@"
+	@$(OBJCOPY) -O ihex $< $@
+	-@$(SIZE) $< || true
+
+# ============================================================================
+# Flash Example (requires avrdude + usbasp)
+# ============================================================================
+flash-%: examples
+	@echo "  FLASH $(BUILD_DIR)/$*.hex"
+	@avrdude -p $(MCU) -c usbasp -U flash:w:$(BUILD_DIR)/$*.hex:i
+.PHONY: flash-%
 
 # ============================================================================
 # Fuse Configuration
@@ -143,7 +189,6 @@ help:
 	@echo "Targets:"
 	@echo "  all              - Build library and all examples (default)"
 	@echo "  examples         - Build all examples"
-	@echo "  blink_led        - Build blink_led example"
 	@echo "  flash-<example>  - Flash example to MCU (e.g., flash-blink_led)"
 	@echo "  read-fuses       - Read fuse bytes from MCU"
 	@echo "  write-fuses-16mhz - Set fuses for 16MHz internal oscillator"
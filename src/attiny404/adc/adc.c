@@ -1,13 +1,58 @@
 #include <stdint.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include "attiny404/adc/adc.h"
 
+static uint8_t scan_channels[ADC_SCAN_MAX_CHANNELS];
+static uint8_t scan_count;
+static uint16_t scan_table[2][ADC_SCAN_MAX_CHANNELS];
+static volatile uint8_t scan_front;     // table adc_scan_read() copies
+static volatile uint8_t scan_seq;
+static uint8_t scan_converting;         // list index of the conversion running
+static uint8_t scan_queued;             // list index written to MUXPOS
+
+static volatile uint8_t stream_active;
+static uint16_t *stream_buf;
+static uint16_t stream_len;
+static uint16_t stream_half;
+static uint16_t stream_pos;
+static adc_stream_callback_t stream_on_half;
+static adc_stream_callback_t stream_on_full;
+
+// VREF.CTRLA ADC0REFSEL for each internal reference
+static const uint8_t intref_sel[] = {
+    [ADC_REF_INTERNAL_0V55] = VREF_ADC0REFSEL_0V55_gc,
+    [ADC_REF_INTERNAL_1V1] = VREF_ADC0REFSEL_1V1_gc,
+    [ADC_REF_INTERNAL_1V5] = VREF_ADC0REFSEL_1V5_gc,
+    [ADC_REF_INTERNAL_2V5] = VREF_ADC0REFSEL_2V5_gc,
+    [ADC_REF_INTERNAL_4V34] = VREF_ADC0REFSEL_4V34_gc,
+};
+
+// CPU cycles for RESRDY to reach the stream ISR, with margin
+#define STREAM_ISR_CYCLES   40
+
+// Sample time the datasheet asks for on the temperature sensor
+#define TEMPSENSE_SAMPLE_US 32
+
+static adc_calibration_t calibration = {
+    .temp_trim_cdeg = 0,
+    .intref_mv = 1100
+};
+
 adc_t adc_init(adc_reference_t ref, adc_prescaler_t prescaler, adc_resolution_t resolution) {
     ADC0.CTRLA = 0;
     ADC0.CTRLC = 0;
 
-    // Set reference and prescaler in CTRLC
-    ADC0.CTRLC = (ref << ADC_REFSEL_gp) | prescaler;
+    // CTRLC REFSEL picks internal, VDD or external; the internal
+    // voltage itself is set in VREF
+    if (ref == ADC_REF_VDD) {
+        ADC0.CTRLC = ADC_REFSEL_VDDREF_gc | prescaler;
+    } else if (ref == ADC_REF_EXTERNAL) {
+        ADC0.CTRLC = (0x02 << ADC_REFSEL_gp) | prescaler;
+    } else {
+        VREF.CTRLA = (VREF.CTRLA & ~VREF_ADC0REFSEL_gm) | intref_sel[ref];
+        ADC0.CTRLC = ADC_REFSEL_INTREF_gc | prescaler;
+    }
 
     // Set resolution in CTRLA (bit 7: RESSEL, 1 = 8-bit, 0 = 10-bit)
     if (resolution == ADC_RES_8BIT) {
@@ -26,7 +71,16 @@ void adc_disable() {
     ADC0.CTRLA &= ~ADC_ENABLE_bm;
 }
 
+// The RESRDY interrupt of a scan or stream would take the result of a
+// single conversion, and stream start events would keep firing
+static void adc_stop_conversions(adc_t *adc) {
+    adc_scan_stop(adc);
+    adc_stream_stop(adc);
+}
+
 uint16_t adc_read_blocking(adc_t *adc, adc_channel_t channel) {
+    adc_stop_conversions(adc);
+
     adc->channel = channel;
     adc->in_progress = 1;
 
@@ -41,6 +95,8 @@ uint16_t adc_read_blocking(adc_t *adc, adc_channel_t channel) {
 }
 
 void adc_read_start(adc_t *adc, adc_channel_t channel) {
+    adc_stop_conversions(adc);
+
     adc->channel = channel;
     adc->in_progress = 1;
 
@@ -59,3 +115,307 @@ uint8_t adc_is_busy(adc_t *adc) {
 uint16_t adc_read_result() {
     return ADC0.RES;
 }
+
+uint16_t adc_read_oversampled(adc_t *adc, adc_channel_t channel, uint8_t extra_bits) {
+    // 4^n samples per hardware result for n = 0..3
+    static const uint8_t sampnum[] = {
+        ADC_SAMPNUM_ACC1_gc, ADC_SAMPNUM_ACC4_gc,
+        ADC_SAMPNUM_ACC16_gc, ADC_SAMPNUM_ACC64_gc
+    };
+
+    if (extra_bits > ADC_OVERSAMPLE_MAX_BITS) {
+        extra_bits = ADC_OVERSAMPLE_MAX_BITS;
+    }
+
+    uint8_t hw_bits = extra_bits > 3 ? 3 : extra_bits;
+    uint8_t blocks = 1 << (2 * (extra_bits - hw_bits));
+    uint32_t sum = 0;
+
+    adc_stop_conversions(adc);
+
+    adc->channel = channel;
+    adc->in_progress = 1;
+
+    ADC0.CTRLB = sampnum[hw_bits];
+    ADC0.MUXPOS = channel;
+
+    // RES holds the 16-bit sum of the accumulated samples
+    do {
+        ADC0.COMMAND = ADC_STCONV_bm;
+        while ((ADC0.INTFLAGS & ADC_RESRDY_bm) == 0);
+        sum += ADC0.RES;
+    } while (--blocks);
+
+    ADC0.CTRLB = ADC_SAMPNUM_ACC1_gc;
+    adc->in_progress = 0;
+
+    return (uint16_t)(sum >> extra_bits);
+}
+
+// Sum of four accumulated samples, 10-bit, of an internal source. The
+// first conversion after the reference switch is thrown away.
+static uint16_t adc_read_internal(adc_t *adc, uint8_t muxpos, uint8_t refsel) {
+    adc_stop_conversions(adc);
+
+    uint8_t ctrla = ADC0.CTRLA;
+    uint8_t ctrlb = ADC0.CTRLB;
+    uint8_t ctrlc = ADC0.CTRLC;
+    uint8_t ctrld = ADC0.CTRLD;
+    uint8_t sampctrl = ADC0.SAMPCTRL;
+    uint8_t muxpos_saved = ADC0.MUXPOS;
+    uint8_t vref = VREF.CTRLA;
+
+    // ADC clock is F_CPU / (2 << prescaler); one sample takes 2 + SAMPLEN clocks.
+    // SAMPLEN stops at 31, so slow the ADC clock until the sample time fits.
+    uint8_t presc = ctrlc & ADC_PRESC_gm;
+    uint16_t clocks;
+    for (;;) {
+        uint16_t cycles = 2U << presc;
+        clocks = ((F_CPU / 1000000UL) * TEMPSENSE_SAMPLE_US + cycles - 1) / cycles;
+        if (clocks <= 2 + 31 || presc == ADC_PRESC_DIV256_gc) {
+            break;
+        }
+        presc++;
+    }
+    uint8_t samplen = clocks > 2 ? clocks - 2 : 0;
+
+    VREF.CTRLA = (vref & ~VREF_ADC0REFSEL_gm) | VREF_ADC0REFSEL_1V1_gc;
+    ADC0.CTRLA = ADC_ENABLE_bm;
+    ADC0.CTRLC = ADC_SAMPCAP_bm | refsel | presc;
+    ADC0.CTRLD = ADC_INITDLY_DLY64_gc;
+    ADC0.SAMPCTRL = samplen > 31 ? 31 : samplen;
+    ADC0.MUXPOS = muxpos;
+
+    ADC0.CTRLB = ADC_SAMPNUM_ACC1_gc;
+    ADC0.COMMAND = ADC_STCONV_bm;
+    while ((ADC0.INTFLAGS & ADC_RESRDY_bm) == 0);
+    (void)ADC0.RES;
+
+    ADC0.CTRLB = ADC_SAMPNUM_ACC4_gc;
+    ADC0.COMMAND = ADC_STCONV_bm;
+    while ((ADC0.INTFLAGS & ADC_RESRDY_bm) == 0);
+    uint16_t sum = ADC0.RES;
+
+    ADC0.CTRLA = 0;
+    ADC0.CTRLB = ctrlb;
+    ADC0.CTRLC = ctrlc;
+    ADC0.CTRLD = ctrld;
+    ADC0.SAMPCTRL = sampctrl;
+    ADC0.MUXPOS = muxpos_saved;
+    VREF.CTRLA = vref;
+    ADC0.CTRLA = ctrla;
+
+    adc->in_progress = 0;
+    return sum;
+}
+
+int16_t adc_read_temperature_cdeg(adc_t *adc) {
+    uint16_t sum = adc_read_internal(adc, ADC_MUXPOS_TEMPSENSE_gc, ADC_REFSEL_INTREF_gc);
+
+    // Factory calibration: T[K] = (RES - offset) * gain / 256
+    uint8_t gain = SIGROW.TEMPSENSE0;
+    int8_t offset = (int8_t)SIGROW.TEMPSENSE1;
+    int32_t t = ((int32_t)sum - 4 * offset) * gain * 100;
+
+    // sum holds four samples: divide by 4 * 256, rounded
+    int32_t cdeg = ((t + 512) >> 10) - 27315;
+    return (int16_t)cdeg + calibration.temp_trim_cdeg;
+}
+
+uint16_t adc_read_vcc_mv(adc_t *adc) {
+    uint16_t sum = adc_read_internal(adc, ADC_MUXPOS_INTREF_gc, ADC_REFSEL_VDDREF_gc);
+
+    if (sum == 0) {
+        return 0;
+    }
+    return (uint16_t)(((uint32_t)calibration.intref_mv * 1024 * 4) / sum);
+}
+
+void adc_calibration_set(const adc_calibration_t *cal) {
+    calibration = *cal;
+}
+
+uint16_t adc_stream_start(adc_t *adc, const adc_stream_config_t *config) {
+    static const uint16_t dividers[] = { 1, 2, 4, 8, 16, 64, 256, 1024 };
+    uint32_t ticks = 0;
+    uint8_t i;
+
+    adc_stop_conversions(adc);
+
+    if (config->rate_hz == 0 || config->length < 2) {
+        return 0;
+    }
+
+    // Fastest TCA0 clock that still fits the period in PER
+    for (i = 0; i < 8; i++) {
+        uint32_t step = (uint32_t)dividers[i] * config->rate_hz;
+        ticks = (F_CPU + step / 2) / step;
+        if (ticks <= 65536UL) {
+            break;
+        }
+    }
+    if (i == 8 || ticks < 2) {
+        return 0;
+    }
+
+    // A start event during a conversion is ignored. One result takes
+    // SAMPDLY + 2 + SAMPLEN + 12 ADC clocks per accumulated sample.
+    uint8_t presc = ADC0.CTRLC & ADC_PRESC_gm;
+    uint16_t conv_clocks = ((ADC0.CTRLD & ADC_SAMPDLY_gm) >> ADC_SAMPDLY_gp) + 14 +
+                           (ADC0.SAMPCTRL & ADC_SAMPLEN_gm);
+    uint32_t min_cycles = ((uint32_t)conv_clocks << (ADC0.CTRLB & ADC_SAMPNUM_gm)) * (2U << presc) +
+                          STREAM_ISR_CYCLES;
+    if ((uint32_t)dividers[i] * ticks < min_cycles) {
+        return 0;
+    }
+
+    stream_buf = config->buffer;
+    stream_len = config->length & ~1U;
+    stream_half = stream_len / 2;
+    stream_pos = 0;
+    stream_on_half = config->on_half;
+    stream_on_full = config->on_full;
+    stream_active = 1;
+
+    adc->channel = config->channel;
+    adc->in_progress = 0;
+
+    ADC0.MUXPOS = config->channel;
+    ADC0.CTRLA |= ADC_ENABLE_bm;
+    ADC0.EVCTRL = ADC_STARTEI_bm;
+    ADC0.INTFLAGS = ADC_RESRDY_bm;
+    ADC0.INTCTRL = ADC_RESRDY_bm;
+
+    // TCA0 overflow -> sync channel 0 -> ADC0 start
+    EVSYS.SYNCCH0 = EVSYS_SYNCCH0_TCA0_OVF_LUNF_gc;
+    EVSYS.ASYNCUSER1 = EVSYS_ASYNCUSER1_SYNCCH0_gc;
+
+    TCA0.SINGLE.CTRLA = 0;
+    TCA0.SINGLE.CTRLB = TCA_SINGLE_WGMODE_NORMAL_gc;
+    TCA0.SINGLE.CNT = 0;
+    TCA0.SINGLE.PER = (uint16_t)(ticks - 1);
+    TCA0.SINGLE.CTRLA = (i << TCA_SINGLE_CLKSEL_gp) | TCA_SINGLE_ENABLE_bm;
+
+    return (uint16_t)(F_CPU / ((uint32_t)dividers[i] * ticks));
+}
+
+void adc_stream_stop(adc_t *adc) {
+    (void)adc;
+
+    if (!stream_active) {
+        return;
+    }
+
+    TCA0.SINGLE.CTRLA = 0;
+    EVSYS.ASYNCUSER1 = 0;
+    ADC0.EVCTRL = 0;
+    ADC0.INTCTRL = 0;
+    stream_active = 0;
+
+    while (ADC0.COMMAND & ADC_STCONV_bm);
+    ADC0.INTFLAGS = ADC_RESRDY_bm;
+}
+
+void adc_scan_start(adc_t *adc, const adc_channel_t *channels, uint8_t count) {
+    adc_stop_conversions(adc);
+
+    if (count == 0) {
+        return;
+    }
+    if (count > ADC_SCAN_MAX_CHANNELS) {
+        count = ADC_SCAN_MAX_CHANNELS;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        scan_channels[i] = channels[i];
+    }
+    scan_count = count;
+    scan_front = 0;
+    scan_seq = 0;
+
+    // The first conversion and the one free-running starts after it both
+    // use the first channel, see the interrupt
+    scan_converting = 0;
+    scan_queued = 0;
+
+    adc->channel = channels[0];
+    adc->in_progress = 0;
+
+    ADC0.MUXPOS = channels[0];
+    ADC0.INTFLAGS = ADC_RESRDY_bm;
+    ADC0.INTCTRL = ADC_RESRDY_bm;
+    ADC0.CTRLA |= ADC_FREERUN_bm | ADC_ENABLE_bm;
+    ADC0.COMMAND = ADC_STCONV_bm;
+}
+
+void adc_scan_stop(adc_t *adc) {
+    (void)adc;
+
+    if (!(ADC0.CTRLA & ADC_FREERUN_bm)) {
+        return;
+    }
+
+    ADC0.CTRLA &= ~ADC_FREERUN_bm;
+    ADC0.INTCTRL = 0;
+
+    // Let the conversion in flight finish so its result is not mistaken
+    // for the next single conversion
+    while (ADC0.COMMAND & ADC_STCONV_bm);
+    ADC0.INTFLAGS = ADC_RESRDY_bm;
+}
+
+uint8_t adc_scan_read(adc_t *adc, uint16_t *results) {
+    (void)adc;
+    uint8_t sreg = SREG;
+    cli();
+
+    const uint16_t *table = scan_table[scan_front];
+    for (uint8_t i = 0; i < scan_count; i++) {
+        results[i] = table[i];
+    }
+    uint8_t seq = scan_seq;
+
+    SREG = sreg;
+    return seq;
+}
+
+// Scan: MUXPOS is sampled when a conversion starts, and in free-running mode
+// the next conversion started when this one finished. So this result
+// belongs to scan_converting, the running conversion uses the channel
+// queued last time, and MUXPOS written now applies to the one after.
+ISR(ADC0_RESRDY_vect) {
+    uint16_t value = ADC0.RES;      // reading RES clears RESRDY
+
+    if (stream_active) {
+        stream_buf[stream_pos] = value;
+        if (++stream_pos == stream_half) {
+            if (stream_on_half) {
+                stream_on_half(stream_buf, stream_half);
+            }
+        } else if (stream_pos == stream_len) {
+            stream_pos = 0;
+            if (stream_on_full) {
+                stream_on_full(stream_buf + stream_half, stream_half);
+            }
+        }
+        return;
+    }
+
+    uint8_t done = scan_converting;
+    uint8_t next = scan_queued + 1;
+
+    if (next == scan_count) {
+        next = 0;
+    }
+    scan_converting = scan_queued;
+    scan_queued = next;
+    ADC0.MUXPOS = scan_channels[next];
+
+    scan_table[scan_front ^ 1][done] = value;
+    if (done == scan_count - 1) {
+        scan_front ^= 1;
+        if (++scan_seq == 0) {
+            scan_seq = 1;
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include "attiny404/gpio/gpio.h"
+
+// Kept out of gpio.c so PORTA_PORT_vect and PORTB_PORT_vect are only
+// linked in when gpio_enable_pcint() is called. Applications with their
+// own port ISR can still use the rest of the GPIO driver.
+
+static gpio_pcint_callback_t pcint_callbacks[12];
+
+static volatile uint8_t *gpio_pinctrl(gpio_pin_t pin) {
+    uint8_t pin_num = pin & 0x07;
+
+    if (pin < 8) {
+        return &(&PORTA.PIN0CTRL)[pin_num];
+    }
+    return &(&PORTB.PIN0CTRL)[pin_num];
+}
+
+void gpio_enable_pcint(gpio_pin_t pin, gpio_pcint_mode_t mode, gpio_pcint_callback_t callback) {
+    uint8_t isc;
+
+    switch (mode) {
+        case GPIO_PCINT_RISING:
+            isc = PORT_ISC_RISING_gc;
+            break;
+        case GPIO_PCINT_FALLING:
+            isc = PORT_ISC_FALLING_gc;
+            break;
+        case GPIO_PCINT_ANY:
+            isc = PORT_ISC_BOTHEDGES_gc;
+            break;
+        default:
+            gpio_disable_pcint(pin);
+            return;
+    }
+
+    volatile uint8_t *pinctrl = gpio_pinctrl(pin);
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        pcint_callbacks[pin] = callback;
+        *pinctrl = (*pinctrl & ~PORT_ISC_gm) | isc;
+    }
+}
+
+void gpio_disable_pcint(gpio_pin_t pin) {
+    volatile uint8_t *pinctrl = gpio_pinctrl(pin);
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *pinctrl = (*pinctrl & ~PORT_ISC_gm) | PORT_ISC_INTDISABLE_gc;
+        pcint_callbacks[pin] = NULL;
+    }
+}
+
+static void gpio_pcint_dispatch(uint8_t flags, gpio_pin_t first) {
+    for (uint8_t i = 0; flags; i++, flags >>= 1) {
+        if ((flags & 0x01) && pcint_callbacks[first + i]) {
+            pcint_callbacks[first + i]((gpio_pin_t)(first + i));
+        }
+    }
+}
+
+ISR(PORTA_PORT_vect) {
+    uint8_t flags = VPORTA.INTFLAGS;
+    VPORTA.INTFLAGS = flags;
+    gpio_pcint_dispatch(flags, GPIO_PA0);
+}
+
+ISR(PORTB_PORT_vect) {
+    uint8_t flags = VPORTB.INTFLAGS;
+    VPORTB.INTFLAGS = flags;
+    gpio_pcint_dispatch(flags, GPIO_PB0);
+}
@@ -1,42 +1,72 @@
 #include <stdint.h>
+#include <stddef.h>
 #include <avr/io.h>
 #include "attiny404/spi/spi.h"
+#include "spi_internal.h"
 
-spi_t spi_init(spi_config_t config) {
-    SPI0.CTRLA = SPI_ENABLE_bm;
+// Device whose settings are currently in CTRLA/CTRLB
+static const spi_device_t *active_device;
+
+// Set while spi_async.c has a transfer running
+volatile uint8_t spi_async_busy;
 
-    switch (config.clock) {
+static uint8_t spi_ctrla_for(spi_clock_t clock, uint8_t msb_first) {
+    uint8_t ctrla = SPI_ENABLE_bm | SPI_MASTER_bm;
+
+    switch (clock) {
         case SPI_CLK_DIV4:
-            SPI0.CTRLA |= SPI_PRESC_DIV4_gc;
+            ctrla |= SPI_PRESC_DIV4_gc;
             break;
         case SPI_CLK_DIV16:
-            SPI0.CTRLA |= SPI_PRESC_DIV16_gc;
+            ctrla |= SPI_PRESC_DIV16_gc;
             break;
         case SPI_CLK_DIV64:
-            SPI0.CTRLA |= SPI_PRESC_DIV64_gc;
+            ctrla |= SPI_PRESC_DIV64_gc;
             break;
         case SPI_CLK_DIV128:
-            SPI0.CTRLA |= SPI_PRESC_DIV128_gc;
+            ctrla |= SPI_PRESC_DIV128_gc;
             break;
     }
 
-    switch (config.mode) {
+    if (!msb_first) {
+        ctrla |= SPI_DORD_bm;
+    }
+
+    return ctrla;
+}
+
+static uint8_t spi_ctrlb_for(spi_mode_t mode) {
+    // SS is not used for multi-master detection; chip selects are GPIOs.
+    // Buffer mode gives a TX buffer and a 2-byte RX FIFO so block
+    // transfers can keep SCK running between bytes.
+    uint8_t ctrlb = SPI_BUFEN_bm | SPI_SSD_bm;
+
+    switch (mode) {
         case SPI_MODE_0:
             break;
         case SPI_MODE_1:
-            SPI0.CTRLB |= SPI_MODE_0_bm;
+            ctrlb |= SPI_MODE_0_bm;
             break;
         case SPI_MODE_2:
-            SPI0.CTRLB |= SPI_MODE_1_bm;
+            ctrlb |= SPI_MODE_1_bm;
             break;
         case SPI_MODE_3:
-            SPI0.CTRLB |= SPI_MODE_0_bm | SPI_MODE_1_bm;
+            ctrlb |= SPI_MODE_0_bm | SPI_MODE_1_bm;
             break;
     }
 
-    if (!config.msb_first) {
-        SPI0.CTRLA |= SPI_DORD_bm;
-    }
+    return ctrlb;
+}
+
+spi_t spi_init(spi_config_t config) {
+    // MOSI (PA1) and SCK (PA3) must be outputs, MISO (PA2) is an input
+    VPORTA.DIR |= PIN1_bm | PIN3_bm;
+    VPORTA.DIR &= ~PIN2_bm;
+
+    SPI0.CTRLB = spi_ctrlb_for(config.mode);
+    SPI0.CTRLA = spi_ctrla_for(config.clock, config.msb_first);
+
+    active_device = NULL;
 
     spi_t spi = {config};
     return spi;
@@ -44,21 +74,135 @@ spi_t spi_init(spi_config_t config) {
 
 uint8_t spi_transfer(uint8_t data) {
     SPI0.DATA = data;
-    while (!(SPI0.INTFLAGS & SPI_IF_bm));
+    while (!(SPI0.INTFLAGS & SPI_RXCIF_bm));
     return SPI0.DATA;
 }
 
 void spi_write(uint8_t data) {
-    SPI0.DATA = data;
-    while (!(SPI0.INTFLAGS & SPI_IF_bm));
+    // The received byte must be read out or it stays in the RX FIFO
+    (void)spi_transfer(data);
 }
 
 uint8_t spi_read() {
-    SPI0.DATA = 0xFF;
-    while (!(SPI0.INTFLAGS & SPI_IF_bm));
-    return SPI0.DATA;
+    return spi_transfer(0xFF);
+}
+
+/*
+ * At most two bytes are in flight (shift register + TX buffer), which
+ * is what the RX FIFO can hold, so no received byte is ever dropped.
+ */
+void spi_transfer_block(const uint8_t *tx, uint8_t *rx, uint16_t len) {
+    uint16_t to_send = len;
+    uint16_t to_recv = len;
+
+    while (to_recv) {
+        if (to_send && (uint16_t)(to_recv - to_send) < 2 &&
+            (SPI0.INTFLAGS & SPI_DREIF_bm)) {
+            SPI0.DATA = *tx++;
+            to_send--;
+        }
+        if (SPI0.INTFLAGS & SPI_RXCIF_bm) {
+            *rx++ = SPI0.DATA;
+            to_recv--;
+        }
+    }
+}
+
+void spi_write_block(const uint8_t *tx, uint16_t len) {
+    if (!len) {
+        return;
+    }
+
+    SPI0.INTFLAGS = SPI_TXCIF_bm;
+
+    while (len--) {
+        while (!(SPI0.INTFLAGS & SPI_DREIF_bm));
+        SPI0.DATA = *tx++;
+    }
+
+    // Received bytes overflowed the FIFO; discard them once the last
+    // byte has left the shift register
+    while (!(SPI0.INTFLAGS & SPI_TXCIF_bm));
+    while (SPI0.INTFLAGS & SPI_RXCIF_bm) {
+        (void)SPI0.DATA;
+    }
+    SPI0.INTFLAGS = SPI_TXCIF_bm | SPI_BUFOVF_bm;
+}
+
+void spi_read_block(uint8_t *rx, uint16_t len) {
+    uint16_t to_send = len;
+    uint16_t to_recv = len;
+
+    while (to_recv) {
+        if (to_send && (uint16_t)(to_recv - to_send) < 2 &&
+            (SPI0.INTFLAGS & SPI_DREIF_bm)) {
+            SPI0.DATA = 0xFF;
+            to_send--;
+        }
+        if (SPI0.INTFLAGS & SPI_RXCIF_bm) {
+            *rx++ = SPI0.DATA;
+            to_recv--;
+        }
+    }
 }
 
 void spi_deinit(void) {
+    SPI0.INTCTRL = 0;
     SPI0.CTRLA = 0;
+    active_device = NULL;
+    spi_async_busy = 0;
+}
+
+void spi_device_init(spi_device_t *dev) {
+    volatile uint8_t *dir;
+
+    gpio_get_port_info(dev->cs_pin, &dev->cs_port, &dir, &dev->cs_mask);
+    *dev->cs_port |= dev->cs_mask;
+    *dir |= dev->cs_mask;
+
+    dev->ctrla = spi_ctrla_for(dev->clock, dev->msb_first);
+    dev->ctrlb = spi_ctrlb_for(dev->mode);
+
+    // Settings may have changed under the same pointer
+    if (active_device == dev) {
+        active_device = NULL;
+    }
+}
+
+void spi_select(const spi_device_t *dev) {
+    if (active_device != dev) {
+        SPI0.CTRLB = dev->ctrlb;
+        SPI0.CTRLA = dev->ctrla;
+        active_device = dev;
+    }
+
+    *dev->cs_port &= ~dev->cs_mask;
+}
+
+void spi_transaction(const spi_device_t *dev, const spi_segment_t *segments, uint8_t count) {
+    while (spi_async_busy);
+
+    spi_select(dev);
+
+    for (uint8_t i = 0; i < count; i++) {
+        const spi_segment_t *seg = &segments[i];
+
+        if (seg->tx && seg->rx) {
+            spi_transfer_block(seg->tx, seg->rx, seg->len);
+        } else if (seg->tx) {
+            spi_write_block(seg->tx, seg->len);
+        } else if (seg->rx) {
+            spi_read_block(seg->rx, seg->len);
+        } else {
+            for (uint16_t n = seg->len; n; n--) {
+                spi_write(0xFF);
+            }
+        }
+    }
+
+    *dev->cs_port |= dev->cs_mask;
+}
+
+uint8_t spi_is_busy(void) {
+    return spi_async_busy;
 }
@@ -0,0 +1,137 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "attiny404/spi/spi.h"
+#include "spi_internal.h"
+
+// Interrupt-driven SPI0 master transfers. Kept out of spi.c so SPI0_INT_vect
+// is only linked in when an async function is called, and the polled master
+// still links with spi_slave.c.
+
+// Interrupt-driven transfer state. TX and RX walk the segment list
+// independently because up to two bytes are in flight.
+static const spi_segment_t *async_segments;
+static uint8_t async_count;
+static spi_callback_t async_callback;
+static const spi_device_t *async_device;
+static spi_segment_t async_single;
+
+static uint8_t tx_seg;
+static const uint8_t *tx_ptr;
+static uint16_t tx_left;
+
+static uint8_t rx_seg;
+static uint8_t *rx_ptr;
+static uint16_t rx_left;
+
+// Skip to the next segment with bytes left; returns 0 at the end of the list
+static uint8_t spi_async_tx_ready(void) {
+    while (!tx_left && tx_seg + 1 < async_count) {
+        tx_seg++;
+        tx_ptr = async_segments[tx_seg].tx;
+        tx_left = async_segments[tx_seg].len;
+    }
+    return tx_left != 0;
+}
+
+static uint8_t spi_async_rx_ready(void) {
+    while (!rx_left && rx_seg + 1 < async_count) {
+        rx_seg++;
+        rx_ptr = async_segments[rx_seg].rx;
+        rx_left = async_segments[rx_seg].len;
+    }
+    return rx_left != 0;
+}
+
+static void spi_async_send_next(void) {
+    SPI0.DATA = tx_ptr ? *tx_ptr++ : 0xFF;
+    tx_left--;
+}
+
+static void spi_async_finish(void) {
+    SPI0.INTCTRL = 0;
+
+    if (async_device) {
+        *async_device->cs_port |= async_device->cs_mask;
+    }
+
+    spi_async_busy = 0;
+
+    if (async_callback) {
+        async_callback();
+    }
+}
+
+static void spi_async_start(const spi_device_t *dev, const spi_segment_t *segments,
+                            uint8_t count, spi_callback_t callback) {
+    async_segments = segments;
+    async_count = count;
+    async_callback = callback;
+    async_device = dev;
+
+    tx_seg = rx_seg = 0;
+    tx_ptr = segments[0].tx;
+    rx_ptr = segments[0].rx;
+    tx_left = rx_left = segments[0].len;
+
+    if (!spi_async_tx_ready()) {
+        spi_async_finish();
+        return;
+    }
+    spi_async_rx_ready();
+
+    spi_async_busy = 1;
+
+    // Prime the shift register and the TX buffer, then let each RX
+    // complete interrupt read one byte and queue one more
+    spi_async_send_next();
+    if (spi_async_tx_ready()) {
+        while (!(SPI0.INTFLAGS & SPI_DREIF_bm));
+        spi_async_send_next();
+    }
+
+    SPI0.INTCTRL = SPI_RXCIE_bm;
+}
+
+void spi_transfer_async(const uint8_t *tx, uint8_t *rx, uint16_t len, spi_callback_t callback) {
+    while (spi_async_busy);
+
+    async_single.tx = tx;
+    async_single.rx = rx;
+    async_single.len = len;
+
+    spi_async_start(NULL, &async_single, 1, callback);
+}
+
+void spi_transaction_async(const spi_device_t *dev, const spi_segment_t *segments,
+                           uint8_t count, spi_callback_t callback) {
+    while (spi_async_busy);
+
+    if (!count) {
+        if (callback) {
+            callback();
+        }
+        return;
+    }
+
+    spi_select(dev);
+    spi_async_start(dev, segments, count, callback);
+}
+
+ISR(SPI0_INT_vect) {
+    uint8_t data = SPI0.DATA;
+
+    if (spi_async_tx_ready()) {
+        spi_async_send_next();
+    }
+
+    if (rx_ptr) {
+        *rx_ptr++ = data;
+    }
+    rx_left--;
+
+    if (!spi_async_rx_ready()) {
+        spi_async_finish();
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef HAL_SPI404_INTERNAL_H
+#define HAL_SPI404_INTERNAL_H
+
+#include <stdint.h>
+#include "attiny404/spi/spi.h"
+
+// Shared by spi.c and spi_async.c, not part of the public API
+
+// Set while an async transfer is running
+extern volatile uint8_t spi_async_busy;
+
+// Loads the device settings if they changed and asserts its chip select
+void spi_select(const spi_device_t *dev);
+
+#endif
@@ -0,0 +1,231 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "attiny404/spi/spi_slave.h"
+
+#define MISO_bm     PIN2_bm
+#define SS_bm       PIN4_bm
+
+#define RX_MASK     (SPI_SLAVE_RX_SIZE - 1)
+#define TX_MASK     (SPI_SLAVE_TX_SIZE - 1)
+
+_Static_assert((SPI_SLAVE_RX_SIZE & RX_MASK) == 0, "SPI_SLAVE_RX_SIZE must be a power of two");
+_Static_assert((SPI_SLAVE_TX_SIZE & TX_MASK) == 0, "SPI_SLAVE_TX_SIZE must be a power of two");
+
+static spi_slave_config_t config;
+
+static uint8_t slave_index;
+static uint8_t slave_overrun_count;
+
+static uint8_t rx_buf[SPI_SLAVE_RX_SIZE];
+static volatile uint8_t rx_head;
+static volatile uint8_t rx_tail;
+
+// tx_peek runs ahead of tx_tail by the ring bytes loaded into SPI0 but
+// not yet clocked out. tx_inflight has one bit per loaded slot, oldest
+// in bit 0, set when that slot came from the ring.
+static uint8_t tx_buf[SPI_SLAVE_TX_SIZE];
+static volatile uint8_t tx_head;
+static volatile uint8_t tx_tail;
+static uint8_t tx_peek;
+static uint8_t tx_inflight;
+static uint8_t tx_loaded;
+
+static void spi_slave_load_next(void) {
+    uint8_t peek = tx_peek;
+
+    if (peek != tx_head) {
+        SPI0.DATA = tx_buf[peek];
+        tx_peek = (peek + 1) & TX_MASK;
+        tx_inflight |= (1 << tx_loaded);
+    } else {
+        SPI0.DATA = 0xFF;
+    }
+    tx_loaded++;
+}
+
+static void spi_slave_commit_oldest(void) {
+    if (tx_inflight & 0x01) {
+        tx_tail = (tx_tail + 1) & TX_MASK;
+    }
+    tx_inflight >>= 1;
+    tx_loaded--;
+}
+
+static void spi_slave_store(uint8_t data) {
+    uint8_t head = rx_head;
+    uint8_t next = (head + 1) & RX_MASK;
+
+    if (next == rx_tail) {
+        slave_overrun_count++;
+    } else {
+        rx_buf[head] = data;
+        rx_head = next;
+    }
+}
+
+/*
+ * BUFWR sends the first write straight to the shift register only while
+ * SS is high; the second waits in the TX buffer. Both have to be in place
+ * before SS falls, since the host may start SCK before the pin interrupt
+ * runs.
+ */
+static void spi_slave_preload(void) {
+    if (config.on_byte) {
+        SPI0.DATA = 0xFF;
+        SPI0.DATA = 0xFF;
+    } else {
+        spi_slave_load_next();
+        spi_slave_load_next();
+    }
+}
+
+static void spi_slave_ss_changed(gpio_pin_t pin) {
+    (void)pin;
+
+    if (VPORTA.IN & SS_bm) {
+        // SPI0 drops whatever is left in the shift register and buffers
+        VPORTA.DIR &= ~MISO_bm;
+        SPI0.INTCTRL = 0;
+
+        // PORTA_PORT_vect outranks SPI0_INT, so the last byte may still be
+        // pending. Store it without loading SPI0, which is preloaded below.
+        while (SPI0.INTFLAGS & SPI_RXCIF_bm) {
+            uint8_t data = SPI0.DATA;
+            uint8_t index = slave_index++;
+
+            if (config.on_byte) {
+                (void)config.on_byte(index, data);
+            } else {
+                spi_slave_commit_oldest();
+                spi_slave_store(data);
+            }
+        }
+
+        tx_peek = tx_tail;
+        tx_inflight = 0;
+        tx_loaded = 0;
+        spi_slave_preload();
+
+        if (config.on_frame) {
+            config.on_frame(slave_index);
+        }
+        return;
+    }
+
+    // The first two slots were loaded while SS was high
+    slave_index = 0;
+
+    while (SPI0.INTFLAGS & SPI_RXCIF_bm) {
+        (void)SPI0.DATA;
+    }
+    SPI0.INTFLAGS = SPI_BUFOVF_bm;
+
+    VPORTA.DIR |= MISO_bm;
+    SPI0.INTCTRL = SPI_RXCIE_bm;
+}
+
+spi_slave_t spi_slave_init(spi_slave_config_t cfg) {
+    uint8_t ctrlb = SPI_BUFEN_bm | SPI_BUFWR_bm;
+
+    config = cfg;
+
+    VPORTA.DIR &= ~(PIN1_bm | MISO_bm | PIN3_bm | SS_bm);
+
+    switch (cfg.mode) {
+        case SPI_MODE_0:
+            break;
+        case SPI_MODE_1:
+            ctrlb |= SPI_MODE_0_bm;
+            break;
+        case SPI_MODE_2:
+            ctrlb |= SPI_MODE_1_bm;
+            break;
+        case SPI_MODE_3:
+            ctrlb |= SPI_MODE_0_bm | SPI_MODE_1_bm;
+            break;
+    }
+
+    SPI0.INTCTRL = 0;
+    SPI0.CTRLB = ctrlb;
+    SPI0.CTRLA = SPI_ENABLE_bm | (cfg.msb_first ? 0 : SPI_DORD_bm);
+
+    rx_head = rx_tail = 0;
+    tx_head = tx_tail = tx_peek = 0;
+    tx_inflight = tx_loaded = 0;
+    slave_overrun_count = 0;
+
+    if (VPORTA.IN & SS_bm) {
+        spi_slave_preload();
+    }
+
+    gpio_enable_pcint(GPIO_PA4, GPIO_PCINT_ANY, spi_slave_ss_changed);
+
+    spi_slave_t slave = { .config = cfg };
+    return slave;
+}
+
+void spi_slave_deinit(void) {
+    gpio_disable_pcint(GPIO_PA4);
+    SPI0.INTCTRL = 0;
+    SPI0.CTRLA = 0;
+    VPORTA.DIR &= ~MISO_bm;
+}
+
+uint8_t spi_slave_available(void) {
+    return (rx_head - rx_tail) & RX_MASK;
+}
+
+uint8_t spi_slave_read(uint8_t *data) {
+    uint8_t tail = rx_tail;
+
+    if (tail == rx_head) {
+        return 0;
+    }
+
+    *data = rx_buf[tail];
+    rx_tail = (tail + 1) & RX_MASK;
+    return 1;
+}
+
+uint8_t spi_slave_write(uint8_t data) {
+    uint8_t head = tx_head;
+    uint8_t next = (head + 1) & TX_MASK;
+
+    if (next == tx_tail) {
+        return 0;
+    }
+
+    tx_buf[head] = data;
+    tx_head = next;
+    return 1;
+}
+
+uint8_t spi_slave_overruns(void) {
+    uint8_t sreg = SREG;
+    cli();
+    uint8_t count = slave_overrun_count;
+    slave_overrun_count = 0;
+    SREG = sreg;
+    return count;
+}
+
+/*
+ * One byte has completed and the TX buffer has moved into the shift
+ * register, so the byte for two slots ahead is written first. The whole
+ * handler has one byte time of the host clock before the RX FIFO fills.
+ */
+ISR(SPI0_INT_vect) {
+    uint8_t data = SPI0.DATA;
+    uint8_t index = slave_index++;
+
+    if (config.on_byte) {
+        SPI0.DATA = config.on_byte(index, data);
+        return;
+    }
+
+    spi_slave_commit_oldest();
+    spi_slave_load_next();
+    spi_slave_store(data);
+}
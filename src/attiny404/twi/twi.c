@@ -1,56 +1,330 @@
 #include <stdint.h>
+#include <stddef.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include "attiny404/twi/twi.h"
 
+#define TWI_FLAGS_gm (TWI_RIF_bm | TWI_WIF_bm | TWI_ARBLOST_bm | TWI_BUSERR_bm)
+
+static twi_xfer_t *volatile queue_head;
+static twi_xfer_t *queue_tail;
+
+static const uint8_t *tx_ptr;
+static uint8_t tx_left;
+static uint8_t *rx_ptr;
+static uint8_t rx_left;
+static uint8_t reading;
+
+// Counts twi_service() calls, so the blocking waits can tell a slow bus
+// from a stuck one
+static volatile uint8_t twi_events;
+static uint16_t wait_loops;
+
+// Approximate cycles per iteration of the wait loops
+#define TWI_WAIT_LOOP_CYCLES 16
+
+static void twi_begin(twi_xfer_t *xfer) {
+    tx_ptr = xfer->tx;
+    tx_left = xfer->tx_len;
+    rx_ptr = xfer->rx;
+    rx_left = xfer->rx_len;
+
+    // Read-only transactions skip the write phase and its repeated START
+    reading = (tx_left == 0 && rx_left != 0);
+    TWI0.MADDR = (xfer->addr << 1) | reading;
+}
+
+static void twi_finish(twi_status_t status) {
+    twi_xfer_t *xfer = queue_head;
+
+    queue_head = xfer->next;
+    if (queue_head) {
+        twi_begin(queue_head);
+    } else {
+        queue_tail = NULL;
+    }
+
+    xfer->status = status;
+    if (xfer->callback) {
+        xfer->callback(xfer);
+    }
+}
+
+// Arbitration loss and bus errors: the bus belongs to someone else or is
+// in an unknown state. Clear the flags and force the state machine idle
+// so the next transaction can start; no STOP is sent.
+static void twi_recover(twi_status_t status) {
+    TWI0.MSTATUS = TWI_FLAGS_gm | TWI_BUSSTATE_IDLE_gc;
+    twi_finish(status);
+}
+
+static void twi_service(void) {
+    uint8_t status = TWI0.MSTATUS;
+
+    twi_events++;
+
+    if (!queue_head) {
+        TWI0.MSTATUS = TWI_FLAGS_gm;
+        return;
+    }
+
+    if (status & TWI_BUSERR_bm) {
+        twi_recover(TWI_ERR_BUSERR);
+        return;
+    }
+    if (status & TWI_ARBLOST_bm) {
+        twi_recover(TWI_ERR_ARBLOST);
+        return;
+    }
+
+    if (status & TWI_WIF_bm) {
+        if (status & TWI_RXACK_bm) {
+            TWI0.MCTRLB = TWI_MCMD_STOP_gc;
+            twi_finish(TWI_ERR_NACK);
+        } else if (tx_left && !reading) {
+            TWI0.MDATA = *tx_ptr++;
+            tx_left--;
+        } else if (rx_left && !reading) {
+            // Writing MADDR while we own the bus issues a repeated START
+            reading = 1;
+            TWI0.MADDR = (queue_head->addr << 1) | 0x01;
+        } else {
+            TWI0.MCTRLB = TWI_MCMD_STOP_gc;
+            twi_finish(TWI_OK);
+        }
+        return;
+    }
+
+    // Smart mode is off, so reading MDATA does not by itself clock in
+    // another byte. Each byte is answered with one command: ACK and
+    // receive the next, or NACK and STOP after the last.
+    if (status & TWI_RIF_bm) {
+        *rx_ptr++ = TWI0.MDATA;
+        if (--rx_left) {
+            TWI0.MCTRLB = TWI_ACKACT_ACK_gc | TWI_MCMD_RECVTRANS_gc;
+        } else {
+            TWI0.MCTRLB = TWI_ACKACT_NACK_gc | TWI_MCMD_STOP_gc;
+            twi_finish(TWI_OK);
+        }
+    }
+}
+
+// With interrupts disabled the flags are serviced here instead
+static void twi_poll(void) {
+    if (!(SREG & CPU_I_bm) && (TWI0.MSTATUS & (TWI_RIF_bm | TWI_WIF_bm))) {
+        twi_service();
+    }
+}
+
+/*
+ * Waits for xfer to finish, or with xfer NULL for the queue to drain.
+ * The TWI bus timeout only covers an idle bus, so a slave holding SCL
+ * low would stall the queue for good. When nothing moves for
+ * timeout_us, the transaction at the head ends with TWI_ERR_TIMEOUT.
+ */
+static void twi_wait_queue(twi_xfer_t *xfer) {
+    uint8_t seen = twi_events;
+    uint16_t loops = wait_loops;
+
+    while (xfer ? xfer->status == TWI_PENDING : queue_head != NULL) {
+        twi_poll();
+
+        if (twi_events != seen) {
+            seen = twi_events;
+            loops = wait_loops;
+        } else if (!--loops) {
+            uint8_t sreg = SREG;
+            cli();
+            if (queue_head && twi_events == seen) {
+                twi_recover(TWI_ERR_TIMEOUT);
+            }
+            SREG = sreg;
+            loops = wait_loops;
+        }
+    }
+}
+
+static twi_status_t twi_wait(twi_xfer_t *xfer) {
+    twi_wait_queue(xfer);
+    return xfer->status;
+}
+
+// Byte-level calls: 0 if the flag is not set within timeout_us
+static uint8_t twi_wait_flag(uint8_t flag) {
+    uint16_t loops = wait_loops;
+
+    while (!(TWI0.MSTATUS & flag)) {
+        if (!--loops) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Nanoseconds to CPU cycles, rounded up
+#define TWI_NS_TO_CYCLES(ns) ((((F_CPU / 1000UL) * (uint32_t)(ns)) + 999999UL) / 1000000UL)
+
+/*
+ * f_SCL = F_CPU / (10 + 2 * BAUD + F_CPU * t_rise)
+ * t_LOW = (BAUD + 5) / F_CPU
+ */
+static uint8_t twi_baud_for(uint32_t f_scl, uint16_t rise_ns, uint16_t low_ns) {
+    int32_t baud = ((int32_t)(F_CPU / f_scl) - 10 - (int32_t)TWI_NS_TO_CYCLES(rise_ns)) / 2;
+    int32_t low_min = (int32_t)TWI_NS_TO_CYCLES(low_ns) - 5;
+
+    if (baud < low_min) {
+        baud = low_min;
+    }
+    if (baud < 0) {
+        baud = 0;
+    } else if (baud > 255) {
+        baud = 255;
+    }
+    return (uint8_t)baud;
+}
+
 twi_t twi_init(twi_config_t config) {
-    TWI0.MBAUD = (config.baud == TWI_BAUD_400KHZ) ? 47 : 255;
-    TWI0.MCTRLA = TWI_ENABLE_bm;
-    TWI0.MSTATUS = TWI_BUSSTATE_IDLE_gc;
+    uint16_t rise = config.rise_ns;
+
+    switch (config.baud) {
+        case TWI_BAUD_1MHZ:
+            TWI0.CTRLA = TWI_FMPEN_bm | TWI_SDAHOLD_50NS_gc;
+            TWI0.MBAUD = twi_baud_for(1000000UL, rise ? rise : TWI_RISE_1MHZ_NS, 500);
+            break;
+        case TWI_BAUD_400KHZ:
+            TWI0.CTRLA = TWI_SDAHOLD_300NS_gc;
+            TWI0.MBAUD = twi_baud_for(400000UL, rise ? rise : TWI_RISE_400KHZ_NS, 1300);
+            break;
+        default:
+            TWI0.CTRLA = TWI_SDAHOLD_300NS_gc;
+            TWI0.MBAUD = twi_baud_for(100000UL, rise ? rise : TWI_RISE_100KHZ_NS, 4700);
+            break;
+    }
+
+    // The bus timeout moves an unknown or stuck bus state back to idle
+    TWI0.MCTRLA = TWI_ENABLE_bm | TWI_RIEN_bm | TWI_WIEN_bm | TWI_TIMEOUT_200US_gc;
+    TWI0.MSTATUS = TWI_FLAGS_gm | TWI_BUSSTATE_IDLE_gc;
+
+    queue_head = queue_tail = NULL;
+
+    uint32_t timeout_us = config.timeout_us ? config.timeout_us : TWI_DEFAULT_TIMEOUT_US;
+    uint32_t loops = timeout_us * (F_CPU / 1000000UL) / TWI_WAIT_LOOP_CYCLES;
+    if (loops == 0) {
+        loops = 1;
+    } else if (loops > 0xFFFF) {
+        loops = 0xFFFF;
+    }
+    wait_loops = (uint16_t)loops;
 
     twi_t twi = {config};
     return twi;
 }
 
+void twi_submit(twi_xfer_t *xfer) {
+    xfer->status = TWI_PENDING;
+    xfer->next = NULL;
+
+    uint8_t sreg = SREG;
+    cli();
+
+    if (queue_tail) {
+        queue_tail->next = xfer;
+        queue_tail = xfer;
+    } else {
+        queue_head = queue_tail = xfer;
+        twi_begin(xfer);
+    }
+
+    SREG = sreg;
+}
+
+uint8_t twi_is_busy(void) {
+    return queue_head != NULL;
+}
+
+twi_status_t twi_write_status(uint8_t addr, const uint8_t *data, uint8_t len) {
+    twi_xfer_t xfer = {
+        .addr = addr,
+        .tx = data,
+        .tx_len = len
+    };
+
+    twi_submit(&xfer);
+    return twi_wait(&xfer);
+}
+
+twi_status_t twi_read_status(uint8_t addr, uint8_t *data, uint8_t len) {
+    twi_xfer_t xfer = {
+        .addr = addr,
+        .rx = data,
+        .rx_len = len
+    };
+
+    twi_submit(&xfer);
+    return twi_wait(&xfer);
+}
+
+uint8_t twi_write_bytes(uint8_t addr, const uint8_t *data, uint8_t len) {
+    return twi_write_status(addr, data, len) == TWI_OK;
+}
+
+uint8_t twi_read_bytes(uint8_t addr, uint8_t *data, uint8_t len) {
+    return twi_read_status(addr, data, len) == TWI_OK;
+}
+
+twi_status_t twi_write_read(uint8_t addr, const uint8_t *wbuf, uint8_t wlen,
+                            uint8_t *rbuf, uint8_t rlen) {
+    twi_xfer_t xfer = {
+        .addr = addr,
+        .tx = wbuf,
+        .tx_len = wlen,
+        .rx = rbuf,
+        .rx_len = rlen
+    };
+
+    twi_submit(&xfer);
+    return twi_wait(&xfer);
+}
+
 void twi_start(void) {
+    twi_wait_queue(NULL);
+
+    // The flags are polled below; twi_service() would clear them
+    TWI0.MCTRLA &= ~(TWI_RIEN_bm | TWI_WIEN_bm);
+    TWI0.MCTRLB = 0;
+
     TWI0.MADDR = 0;
-    while (!(TWI0.MSTATUS & TWI_WIF_bm));
+    twi_wait_flag(TWI_WIF_bm);
 }
 
 void twi_stop(void) {
-    TWI0.MCTRLB = TWI_MCMD_STOP_gc;
+    // Keeps a NACK set by twi_read(0) for the last byte
+    TWI0.MCTRLB = (TWI0.MCTRLB & TWI_ACKACT_bm) | TWI_MCMD_STOP_gc;
+
+    TWI0.MSTATUS = TWI_RIF_bm | TWI_WIF_bm;
+    TWI0.MCTRLA |= TWI_RIEN_bm | TWI_WIEN_bm;
 }
 
 uint8_t twi_write(uint8_t data) {
     TWI0.MDATA = data;
-    while (!(TWI0.MSTATUS & TWI_WIF_bm));
+    if (!twi_wait_flag(TWI_WIF_bm)) {
+        return 0;
+    }
     return !(TWI0.MSTATUS & TWI_ARBLOST_bm);
 }
 
 uint8_t twi_read(uint8_t ack) {
-    while (!(TWI0.MSTATUS & TWI_RIF_bm));
+    if (!twi_wait_flag(TWI_RIF_bm)) {
+        return 0xFF;
+    }
     uint8_t data = TWI0.MDATA;
-    TWI0.MCTRLB = ack ? TWI_ACKACT_ACK_gc : TWI_ACKACT_NACK_gc;
-    return data;
-}
-
-uint8_t twi_write_bytes(uint8_t addr, const uint8_t *data, uint8_t len) {
-    TWI0.MADDR = addr << 1;
-    if (TWI0.MSTATUS & TWI_ARBLOST_bm) return 0;
 
-    for (uint8_t i = 0; i < len; i++) {
-        if (!twi_write(data[i])) return 0;
-    }
-    twi_stop();
-    return 1;
+    // Smart mode is off: an ACK also clocks in the next byte, a NACK
+    // waits for twi_stop()
+    TWI0.MCTRLB = ack ? (TWI_ACKACT_ACK_gc | TWI_MCMD_RECVTRANS_gc) : TWI_ACKACT_NACK_gc;
+    return data;
 }
 
-uint8_t twi_read_bytes(uint8_t addr, uint8_t *data, uint8_t len) {
-    TWI0.MADDR = (addr << 1) | 0x01;
-    if (TWI0.MSTATUS & TWI_ARBLOST_bm) return 0;
-
-    for (uint8_t i = 0; i < len; i++) {
-        data[i] = twi_read(i < len - 1);
-    }
-    twi_stop();
-    return 1;
+ISR(TWI0_TWIM_vect) {
+    twi_service();
 }
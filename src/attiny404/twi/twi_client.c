@@ -0,0 +1,191 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "attiny404/twi/twi_client.h"
+
+static twi_client_config_t config;
+
+// front is what the master reads, back is what the application writes
+static uint8_t *volatile front;
+static uint8_t *volatile back;
+
+static volatile uint8_t active;
+static volatile uint8_t swap_pending;
+
+static uint8_t reg_ptr;
+static uint8_t reg_ptr_next;    // next written byte is the register pointer
+static uint8_t bytes_sent;
+
+static uint8_t write_pending;
+static uint8_t write_lo;
+static uint8_t write_hi;
+
+// Interrupts off: the new back buffer is refreshed from the new front,
+// and a master write storing into both must not land in between
+static void twi_client_swap(void) {
+    uint8_t *tmp = front;
+    front = back;
+    back = tmp;
+    memcpy(tmp, front, config.size);
+    swap_pending = 0;
+}
+
+static void twi_client_store(uint8_t data) {
+    uint8_t reg = reg_ptr;
+    uint8_t mask = config.write_mask ? config.write_mask[reg] : 0xFF;
+
+    // Both buffers, so the value survives the next swap
+    front[reg] = (front[reg] & ~mask) | (data & mask);
+    if (config.shadow) {
+        back[reg] = (back[reg] & ~mask) | (data & mask);
+    }
+
+    if (!write_pending) {
+        write_lo = write_hi = reg;
+        write_pending = 1;
+    } else if (reg < write_lo) {
+        write_lo = reg;
+    } else if (reg > write_hi) {
+        write_hi = reg;
+    }
+
+    if (++reg_ptr >= config.size) {
+        reg_ptr = 0;
+    }
+}
+
+static void twi_client_end(void) {
+    active = 0;
+
+    if (swap_pending) {
+        twi_client_swap();
+    }
+
+    if (write_pending) {
+        write_pending = 0;
+        if (config.on_write) {
+            config.on_write(write_lo, write_hi - write_lo + 1);
+        }
+    }
+}
+
+twi_client_t twi_client_init(twi_client_config_t cfg) {
+    twi_client_t client = { .config = cfg };
+
+    // The register pointer wraps at size, so an empty file cannot work
+    if (cfg.size == 0) {
+        return client;
+    }
+
+    config = cfg;
+
+    front = cfg.regs;
+    back = cfg.shadow ? cfg.shadow : cfg.regs;
+    if (cfg.shadow) {
+        memcpy(cfg.shadow, cfg.regs, cfg.size);
+    }
+
+    active = 0;
+    swap_pending = 0;
+    reg_ptr = 0;
+    write_pending = 0;
+
+    // CTRLA is shared with the master; leave its other bits alone
+    uint8_t ctrla = TWI0.CTRLA & ~(TWI_FMPEN_bm | TWI_SDAHOLD_gm);
+    if (cfg.speed == TWI_BAUD_1MHZ) {
+        TWI0.CTRLA = ctrla | TWI_FMPEN_bm | TWI_SDAHOLD_50NS_gc;
+    } else {
+        TWI0.CTRLA = ctrla | TWI_SDAHOLD_300NS_gc;
+    }
+
+    TWI0.SADDR = cfg.address << 1;
+    TWI0.SSTATUS = TWI_DIF_bm | TWI_APIF_bm | TWI_COLL_bm | TWI_BUSERR_bm;
+    TWI0.SCTRLA = TWI_DIEN_bm | TWI_APIEN_bm | TWI_PIEN_bm | TWI_SMEN_bm | TWI_ENABLE_bm;
+
+    return client;
+}
+
+void twi_client_deinit(void) {
+    TWI0.SCTRLA = 0;
+}
+
+uint8_t *twi_client_regs(void) {
+    return back;
+}
+
+uint8_t twi_client_publish(void) {
+    uint8_t published = 1;
+
+    if (!config.shadow) {
+        return 1;
+    }
+
+    uint8_t sreg = SREG;
+    cli();
+    if (active) {
+        // Swapped at the STOP of the running transaction
+        swap_pending = 1;
+        published = 0;
+    } else {
+        twi_client_swap();
+    }
+    SREG = sreg;
+
+    return published;
+}
+
+uint8_t twi_client_publish_pending(void) {
+    return swap_pending;
+}
+
+ISR(TWI0_TWIS_vect) {
+    uint8_t status = TWI0.SSTATUS;
+
+    if (status & (TWI_COLL_bm | TWI_BUSERR_bm)) {
+        TWI0.SSTATUS = TWI_COLL_bm | TWI_BUSERR_bm;
+        TWI0.SCTRLB = TWI_SCMD_COMPTRANS_gc;
+        twi_client_end();
+        return;
+    }
+
+    if (status & TWI_APIF_bm) {
+        if (status & TWI_AP_bm) {
+            // Address match, also after a repeated START
+            active = 1;
+            bytes_sent = 0;
+            reg_ptr_next = !(status & TWI_DIR_bm);
+            TWI0.SCTRLB = TWI_ACKACT_ACK_gc | TWI_SCMD_RESPONSE_gc;
+        } else {
+            TWI0.SCTRLB = TWI_SCMD_COMPTRANS_gc;
+            twi_client_end();
+        }
+        return;
+    }
+
+    if (status & TWI_DIF_bm) {
+        if (status & TWI_DIR_bm) {
+            // Master read. A NACK on the previous byte ends it.
+            if (bytes_sent && (status & TWI_RXACK_bm)) {
+                TWI0.SCTRLB = TWI_SCMD_COMPTRANS_gc;
+                return;
+            }
+            // Smart mode: writing SDATA releases SCL
+            TWI0.SDATA = front[reg_ptr];
+            bytes_sent = 1;
+            if (++reg_ptr >= config.size) {
+                reg_ptr = 0;
+            }
+        } else {
+            // Smart mode: reading SDATA sends the ACK and releases SCL
+            uint8_t data = TWI0.SDATA;
+            if (reg_ptr_next) {
+                reg_ptr = data < config.size ? data : 0;
+                reg_ptr_next = 0;
+            } else {
+                twi_client_store(data);
+            }
+        }
+    }
+}
@@ -6,7 +6,90 @@
 #include <stdint.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/delay.h>
 #include "attiny85/adc/adc.h"
+#include "attiny85/eeprom/eeprom.h"
+#include "attiny85/util/assert.h"
+
+#define RING_MASK   (ADC_RING_SIZE - 1)
+
+HAL_STATIC_ASSERT((ADC_RING_SIZE & RING_MASK) == 0, "ADC_RING_SIZE must be a power of two");
+HAL_STATIC_ASSERT(ADC_RING_SIZE <= 128, "ADC_RING_SIZE must fit the 8-bit ring indices");
+
+#define ADC_CAL_MAGIC   0xCA1B
+
+// Conversions averaged by the temperature and VCC reads
+#define SENSOR_SAMPLES  4
+
+// Conversions averaged per differential offset
+#define OFFSET_SAMPLES  4
+
+// MUX 4-11 are the differential channels: bit 3 picks the ADC0/ADC1
+// pairs, bit 0 the 20x gain, bit 1 clear means both inputs are the same
+#define DIFF_IS(ch)         ((ch) >= ADC_CHANNEL_DIFF_2_2_X1 && (ch) <= ADC_CHANNEL_DIFF_0_1_X20)
+#define DIFF_OFFSET_IDX(ch) ((((ch) >> 2) & 0x02) | ((ch) & 0x01))
+#define DIFF_SHORTED(idx)   ((((idx) & 0x02) ? 0x08 : 0x04) | ((idx) & 0x01))
+
+// CPU cycles from ADIF to the OCF0A clear in ADC_vect, with margin
+#define STREAM_ISR_CYCLES   40
+
+// ADATE off, ADIF cleared, ADIE on
+#define ADCSRA_START(prescaler) ((1 << ADEN) | (1 << ADSC) | (1 << ADIF) | (1 << ADIE) | (prescaler))
+
+// What ADC_vect does with each result
+typedef enum {
+    ADC_MODE_IDLE,
+    ADC_MODE_SINGLE,
+    ADC_MODE_FREE_RUN,
+    ADC_MODE_SCAN,
+    ADC_MODE_OVERSAMPLE,
+    ADC_MODE_STREAM,
+} adc_mode_t;
+
+static volatile uint8_t adc_mode;
+
+static uint16_t *stream_buf;
+static uint16_t stream_len;
+static uint16_t stream_half;
+static uint16_t stream_pos;
+static adc_stream_callback_t stream_on_half;
+static adc_stream_callback_t stream_on_full;
+
+static int16_t diff_offset[4];
+static uint8_t diff_offset_valid;
+
+static adc_calibration_t calibration = {
+    .ts_code_25c = 300,
+    .ts_cdeg_per_lsb = 23771,   // 1 / 1.077 LSB per C
+    .bandgap_mv = 1100
+};
+
+static volatile uint16_t single_result;
+static volatile uint8_t single_done;
+static volatile uint8_t single_discard;     // gain stage still settling
+
+static uint16_t ring_buf[ADC_RING_SIZE];
+static volatile uint8_t ring_head;
+static volatile uint8_t ring_tail;
+static uint8_t ring_overrun_count;
+
+static uint8_t decim_factor;
+static uint8_t decim_count;
+static uint16_t decim_sum;
+
+static uint32_t os_sum;
+static uint16_t os_count;
+static uint16_t os_left;
+static uint8_t os_bits;
+
+static uint8_t scan_channels[ADC_SCAN_MAX_CHANNELS];
+static uint8_t scan_count;
+static uint16_t scan_table[2][ADC_SCAN_MAX_CHANNELS];
+static volatile uint8_t scan_front;     // table adc_scan_read() copies
+static volatile uint8_t scan_seq;
+static uint8_t scan_converting;         // list index of the conversion running
+static uint8_t scan_queued;             // list index written to ADMUX
 
 adc_t adc_init(adc_reference_t ref, adc_prescaler_t prescaler) {
     uint8_t ref_bits = 0;
@@ -16,20 +99,23 @@ adc_t adc_init(adc_reference_t ref, adc_prescaler_t prescaler) {
             ref_bits = 0;
             break;
         case ADC_REF_INTERNAL_1V1:
-            ref_bits = (1 << REFS0);
+            ref_bits = (1 << REFS1);
             break;
         case ADC_REF_EXTERNAL:
-            ref_bits = (1 << REFS1);
+            ref_bits = (1 << REFS0);
             break;
     }
 
     ADMUX = ref_bits;
     ADCSRA = prescaler;
+    ADCSRB = 0;
+    diff_offset_valid = 0;
 
     adc_t adc = {
         .ref = ref,
         .prescaler = prescaler,
         .in_progress = 0,
+        .bipolar = 0,
         .channel = 0
     };
     return adc;
@@ -44,9 +130,40 @@ void adc_disable(adc_t *adc) {
     adc->in_progress = 0;
 }
 
+/*
+ * Stops free-running, scan and stream conversions and waits for the one
+ * in flight. Setting ADSC while a conversion runs does nothing, and its
+ * result would belong to the previous ADMUX channel. A conversion from
+ * adc_read_start() is finished here and left for adc_read_poll().
+ */
+static void adc_stop_conversions(void) {
+    uint8_t sreg = SREG;
+    cli();
+    uint8_t mode = adc_mode;
+    ADCSRA &= ~((1 << ADATE) | (1 << ADIE));
+    adc_mode = ADC_MODE_IDLE;
+    SREG = sreg;
+
+    while (ADCSRA & (1 << ADSC)) {
+    }
+
+    if (mode == ADC_MODE_SINGLE) {
+        if (single_discard) {
+            single_discard = 0;
+            ADCSRA |= (1 << ADSC);
+            while (ADCSRA & (1 << ADSC)) {
+            }
+        }
+        single_result = ADC;
+        single_done = 1;
+    }
+}
+
 uint16_t adc_read_blocking(adc_t *adc, adc_channel_t channel) {
     uint16_t result;
 
+    // Takes the ADC over from any interrupt-driven mode
+    adc_stop_conversions();
     ADMUX = (ADMUX & 0xF0) | channel;
     ADCSRA |= (1 << ADSC);
 
@@ -60,13 +177,211 @@ uint16_t adc_read_blocking(adc_t *adc, adc_channel_t channel) {
     return result;
 }
 
+uint16_t adc_read_quiet(adc_t *adc, adc_channel_t channel) {
+    uint8_t sleep_bits = MCUCR & ((1 << SE) | (1 << SM1) | (1 << SM0));
+    uint8_t retries = ADC_QUIET_RETRIES;
+    uint8_t sreg = SREG;
+
+    // A conversion left running by another mode would otherwise land
+    // as this result
+    adc_stop_conversions();
+
+    // An adc_read_start() result not yet polled is handed back below
+    uint8_t pending = single_done;
+    uint16_t pending_result = single_result;
+
+    ADMUX = (ADMUX & 0xF0) | channel;
+    ADCSRB &= ~((1 << ADTS2) | (1 << ADTS1) | (1 << ADTS0));
+    set_sleep_mode(SLEEP_MODE_ADC);
+
+    cli();
+    sleep_enable();
+
+    while (1) {
+        uint8_t disturbed = 0;
+
+        // No ADSC: entering the sleep mode starts the conversion
+        single_done = 0;
+        adc_mode = ADC_MODE_SINGLE;
+        ADCSRA = (1 << ADEN) | (1 << ADIF) | (1 << ADIE) | adc->prescaler;
+
+        while (!single_done) {
+            // sei takes effect after sleep, so ADC_vect cannot slip in
+            // between the check and the sleep
+            sei();
+            sleep_cpu();
+            cli();
+
+            // Woken by something else; the conversion went on with the
+            // CPU running
+            if (!single_done) {
+                disturbed = 1;
+            }
+        }
+
+        if (!disturbed || retries == 0) {
+            break;
+        }
+        retries--;
+    }
+
+    MCUCR = (MCUCR & ~((1 << SE) | (1 << SM1) | (1 << SM0))) | sleep_bits;
+    uint16_t result = single_result;
+    single_result = pending_result;
+    single_done = pending;
+    SREG = sreg;
+
+    adc->in_progress = pending;
+    adc->channel = channel;
+    return result;
+}
+
+void adc_set_bipolar(adc_t *adc, uint8_t enable) {
+    if (enable) {
+        ADCSRB |= (1 << BIN);
+    } else {
+        ADCSRB &= ~(1 << BIN);
+    }
+    adc->bipolar = enable ? 1 : 0;
+    diff_offset_valid = 0;
+}
+
+static int16_t adc_sign_extend(adc_t *adc, uint16_t raw) {
+    // BIN: 10-bit two's complement
+    if (adc->bipolar && (raw & 0x200)) {
+        return (int16_t)raw - 1024;
+    }
+    return (int16_t)raw;
+}
+
+static void adc_diff_measure(adc_t *adc, uint8_t idx) {
+    uint8_t shorted = DIFF_SHORTED(idx);
+    int16_t sum = 0;
+
+    // The gain stage needs one conversion to settle after a MUX change
+    adc_read_blocking(adc, shorted);
+    for (uint8_t i = 0; i < OFFSET_SAMPLES; i++) {
+        sum += adc_sign_extend(adc, adc_read_blocking(adc, shorted));
+    }
+
+    diff_offset[idx] = sum / OFFSET_SAMPLES;
+    diff_offset_valid |= 1 << idx;
+}
+
+static void adc_diff_prepare(adc_t *adc, uint8_t channel) {
+    uint8_t idx = DIFF_OFFSET_IDX(channel);
+
+    if (!(diff_offset_valid & (1 << idx))) {
+        adc_diff_measure(adc, idx);
+    }
+}
+
+void adc_diff_calibrate(adc_t *adc) {
+    for (uint8_t idx = 0; idx < 4; idx++) {
+        adc_diff_measure(adc, idx);
+    }
+}
+
+int16_t adc_to_signed(adc_t *adc, adc_channel_t channel, uint16_t raw) {
+    int16_t value = adc_sign_extend(adc, raw);
+
+    if (DIFF_IS(channel) && (diff_offset_valid & (1 << DIFF_OFFSET_IDX(channel)))) {
+        value -= diff_offset[DIFF_OFFSET_IDX(channel)];
+    }
+    return value;
+}
+
+int16_t adc_read_signed(adc_t *adc, adc_channel_t channel) {
+    if (DIFF_IS(channel)) {
+        adc_diff_prepare(adc, channel);
+        if ((ADMUX & 0x0F) != channel) {
+            adc_read_blocking(adc, channel);
+        }
+    }
+    return adc_to_signed(adc, channel, adc_read_blocking(adc, channel));
+}
+
+/*
+ * Sum of SENSOR_SAMPLES conversions of an internal source. The
+ * bandgap and the sensor need time after being selected, so a change
+ * of ADMUX gets a delay and a discarded conversion first.
+ */
+static uint16_t adc_read_internal(adc_t *adc, uint8_t admux) {
+    uint8_t saved = ADMUX;
+    uint16_t sum = 0;
+
+    if (saved != admux) {
+        ADMUX = admux;
+        _delay_us(ADC_REF_SETTLE_US);
+        adc_read_blocking(adc, admux & 0x0F);
+    }
+
+    for (uint8_t i = 0; i < SENSOR_SAMPLES; i++) {
+        sum += adc_read_blocking(adc, admux & 0x0F);
+    }
+
+    ADMUX = saved;
+    return sum;
+}
+
+int16_t adc_read_temperature_cdeg(adc_t *adc) {
+    uint16_t sum = adc_read_internal(adc, (1 << REFS1) | ADC_CHANNEL_TEMP);
+    int16_t delta = (int16_t)(sum - SENSOR_SAMPLES * calibration.ts_code_25c);
+
+    // delta is in 1/4 LSB, the slope in 1/256 cdeg per LSB
+    return 2500 + (int16_t)(((int32_t)delta * calibration.ts_cdeg_per_lsb) / (SENSOR_SAMPLES * 256L));
+}
+
+uint16_t adc_read_vcc_mv(adc_t *adc) {
+    uint16_t sum = adc_read_internal(adc, ADC_CHANNEL_1V1);
+
+    if (sum == 0) {
+        return 0;
+    }
+    return (uint16_t)(((uint32_t)calibration.bandgap_mv * 1024 * SENSOR_SAMPLES) / sum);
+}
+
+void adc_calibration_set(const adc_calibration_t *cal) {
+    calibration = *cal;
+}
+
+uint8_t adc_calibration_load(uint16_t eeprom_addr) {
+    adc_calibration_t cal;
+
+    if (hal_eeprom_read_byte(eeprom_addr) != (ADC_CAL_MAGIC & 0xFF) ||
+        hal_eeprom_read_byte(eeprom_addr + 1) != (ADC_CAL_MAGIC >> 8)) {
+        return 0;
+    }
+
+    hal_eeprom_read_block(&cal, eeprom_addr + 2, sizeof(cal));
+    calibration = cal;
+    return 1;
+}
+
+void adc_calibration_store(uint16_t eeprom_addr, const adc_calibration_t *cal) {
+    hal_eeprom_update_byte(eeprom_addr, ADC_CAL_MAGIC & 0xFF);
+    hal_eeprom_update_byte(eeprom_addr + 1, ADC_CAL_MAGIC >> 8);
+    hal_eeprom_update_block(cal, eeprom_addr + 2, sizeof(*cal));
+}
+
 adc_status_t adc_read_start(adc_t *adc, adc_channel_t channel) {
-    if (adc->in_progress) {
+    if (adc->in_progress || adc_mode != ADC_MODE_IDLE) {
         return ADC_BUSY;
     }
 
+    // Measuring the offset takes blocking conversions, so it has to be
+    // done beforehand with adc_diff_calibrate()
+    if (DIFF_IS(channel) && !(diff_offset_valid & (1 << DIFF_OFFSET_IDX(channel)))) {
+        return ADC_ERROR;
+    }
+
+    single_done = 0;
+    single_discard = DIFF_IS(channel) && (ADMUX & 0x0F) != channel;
+    adc_mode = ADC_MODE_SINGLE;
+
     ADMUX = (ADMUX & 0xF0) | channel;
-    ADCSRA |= (1 << ADSC);
+    ADCSRB &= ~((1 << ADTS2) | (1 << ADTS1) | (1 << ADTS0));
+    ADCSRA = ADCSRA_START(adc->prescaler);
 
     adc->in_progress = 1;
     adc->channel = channel;
@@ -75,28 +390,360 @@ adc_status_t adc_read_start(adc_t *adc, adc_channel_t channel) {
 }
 
 adc_status_t adc_read_poll(adc_t *adc, uint16_t *out_value) {
-    if (!(ADCSRA & (1 << ADSC))) {
-        if (ADCSRA & (1 << ADIF)) {
-            uint16_t result = ADCL;
-            result |= (ADCH << 8);
+    if (!single_done) {
+        return ADC_BUSY;
+    }
 
-            if (out_value) {
-                *out_value = result;
-            }
+    if (out_value) {
+        uint8_t sreg = SREG;
+        cli();
+        *out_value = single_result;
+        SREG = sreg;
+    }
 
-            adc->in_progress = 0;
-            return ADC_OK;
+    single_done = 0;
+    adc->in_progress = 0;
+    return ADC_OK;
+}
+
+// Empties the ring and starts free-running conversions feeding it
+static void adc_ring_start(adc_t *adc, adc_channel_t channel, adc_mode_t mode) {
+    ring_head = ring_tail = 0;
+    ring_overrun_count = 0;
+
+    adc_mode = mode;
+    adc->in_progress = 0;
+    adc->channel = channel;
+
+    // ADTS = 000: free running, each conversion starts the next
+    ADMUX = (ADMUX & 0xF0) | channel;
+    ADCSRB &= ~((1 << ADTS2) | (1 << ADTS1) | (1 << ADTS0));
+    ADCSRA = ADCSRA_START(adc->prescaler) | (1 << ADATE);
+}
+
+void adc_free_run_start(adc_t *adc, adc_channel_t channel, uint8_t decimation) {
+    adc_stop_conversions();
+
+    // 64 * 1023 still fits the 16-bit sum
+    if (decimation == 0) {
+        decimation = 1;
+    } else if (decimation > 64) {
+        decimation = 64;
+    }
+    decim_factor = decimation;
+    decim_count = 0;
+    decim_sum = 0;
+
+    adc_ring_start(adc, channel, ADC_MODE_FREE_RUN);
+}
+
+void adc_oversample_start(adc_t *adc, adc_channel_t channel, uint8_t extra_bits) {
+    adc_stop_conversions();
+
+    if (extra_bits > ADC_OVERSAMPLE_MAX_BITS) {
+        extra_bits = ADC_OVERSAMPLE_MAX_BITS;
+    }
+    os_bits = extra_bits;
+    os_count = os_left = 1U << (2 * extra_bits);
+    os_sum = 0;
+
+    adc_ring_start(adc, channel, ADC_MODE_OVERSAMPLE);
+}
+
+uint16_t adc_read_oversampled(adc_t *adc, adc_channel_t channel, uint8_t extra_bits) {
+    if (extra_bits > ADC_OVERSAMPLE_MAX_BITS) {
+        extra_bits = ADC_OVERSAMPLE_MAX_BITS;
+    }
+
+    uint16_t left = 1U << (2 * extra_bits);
+    uint32_t sum = 0;
+
+    // Otherwise the first ADIF counted is a conversion on the old channel
+    adc_stop_conversions();
+    ADMUX = (ADMUX & 0xF0) | channel;
+    ADCSRB &= ~((1 << ADTS2) | (1 << ADTS1) | (1 << ADTS0));
+    ADCSRA = (1 << ADEN) | (1 << ADSC) | (1 << ADATE) | (1 << ADIF) | adc->prescaler;
+
+    do {
+        while (!(ADCSRA & (1 << ADIF))) {
         }
+        ADCSRA |= (1 << ADIF);
+        sum += ADC;
+    } while (--left);
+
+    // Let the conversion already started finish before anyone else
+    // reuses the ADC
+    ADCSRA &= ~(1 << ADATE);
+    while (ADCSRA & (1 << ADSC)) {
     }
 
-    return ADC_BUSY;
+    adc->channel = channel;
+    return (uint16_t)(sum >> extra_bits);
+}
+
+void adc_free_run_stop(adc_t *adc) {
+    (void)adc;
+    adc_stop_conversions();
+}
+
+uint8_t adc_available(adc_t *adc) {
+    (void)adc;
+    return (ring_head - ring_tail) & RING_MASK;
+}
+
+uint8_t adc_ring_read(adc_t *adc, uint16_t *value) {
+    (void)adc;
+    uint8_t tail = ring_tail;
+
+    if (tail == ring_head) {
+        return 0;
+    }
+
+    *value = ring_buf[tail];
+    ring_tail = (tail + 1) & RING_MASK;
+    return 1;
+}
+
+uint8_t adc_overruns(adc_t *adc) {
+    (void)adc;
+    uint8_t sreg = SREG;
+    cli();
+    uint8_t count = ring_overrun_count;
+    ring_overrun_count = 0;
+    SREG = sreg;
+    return count;
+}
+
+uint16_t adc_stream_start(adc_t *adc, const adc_stream_config_t *config) {
+    static const uint16_t dividers[] = { 1, 8, 64, 256, 1024 };
+    uint32_t ticks = 0;
+    uint8_t cs;
+
+    adc_stop_conversions();
+
+    if (config->rate_hz == 0 || config->length < 2) {
+        return 0;
+    }
+
+    // Fastest timer clock that still fits the period in OCR0A
+    for (cs = 0; cs < 5; cs++) {
+        uint32_t step = (uint32_t)dividers[cs] * config->rate_hz;
+        ticks = (F_CPU + step / 2) / step;
+        if (ticks <= 256) {
+            break;
+        }
+    }
+    if (cs == 5 || ticks == 0) {
+        return 0;
+    }
+
+    // A trigger edge during a conversion (13.5 ADC clocks) is dropped,
+    // and ADC_vect has to clear OCF0A before the next edge
+    uint8_t ps = adc->prescaler;
+    uint32_t min_cycles = 14UL * (ps ? (1U << ps) : 2) + STREAM_ISR_CYCLES;
+    if ((uint32_t)dividers[cs] * ticks < min_cycles) {
+        return 0;
+    }
+
+    stream_buf = config->buffer;
+    stream_len = config->length & ~1U;
+    stream_half = stream_len / 2;
+    stream_pos = 0;
+    stream_on_half = config->on_half;
+    stream_on_full = config->on_full;
+
+    adc_mode = ADC_MODE_STREAM;
+    adc->in_progress = 0;
+    adc->channel = config->channel;
+
+    TCCR0B = 0;
+    TIMSK &= ~((1 << OCIE0A) | (1 << OCIE0B) | (1 << TOIE0));
+    TCCR0A = (1 << WGM01);
+    TCNT0 = 0;
+    OCR0A = (uint8_t)(ticks - 1);
+    TIFR = (1 << OCF0A);
+
+    // ADTS = 011: Timer0 compare match A. No ADSC, the timer starts
+    // every conversion.
+    ADMUX = (ADMUX & 0xF0) | config->channel;
+    ADCSRB = (ADCSRB & ~((1 << ADTS2) | (1 << ADTS1) | (1 << ADTS0))) | (1 << ADTS1) | (1 << ADTS0);
+    ADCSRA = (1 << ADEN) | (1 << ADATE) | (1 << ADIF) | (1 << ADIE) | adc->prescaler;
+
+    TCCR0B = cs + 1;
+
+    return (uint16_t)(F_CPU / ((uint32_t)dividers[cs] * ticks));
+}
+
+void adc_stream_stop(adc_t *adc) {
+    (void)adc;
+    TCCR0B = 0;
+    adc_stop_conversions();
+}
+
+void adc_scan_start(adc_t *adc, const adc_channel_t *channels, uint8_t count) {
+    adc_stop_conversions();
+
+    if (count == 0) {
+        return;
+    }
+    if (count > ADC_SCAN_MAX_CHANNELS) {
+        count = ADC_SCAN_MAX_CHANNELS;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        scan_channels[i] = channels[i];
+        if (DIFF_IS(channels[i])) {
+            adc_diff_prepare(adc, channels[i]);
+        }
+    }
+    scan_count = count;
+    scan_front = 0;
+    scan_seq = 0;
+
+    // The conversion started below and the one the hardware starts after
+    // it both use the first channel, see ADC_vect
+    scan_converting = 0;
+    scan_queued = 0;
+
+    adc_mode = ADC_MODE_SCAN;
+    adc->in_progress = 0;
+    adc->channel = channels[0];
+
+    ADMUX = (ADMUX & 0xF0) | channels[0];
+    ADCSRB &= ~((1 << ADTS2) | (1 << ADTS1) | (1 << ADTS0));
+    ADCSRA = ADCSRA_START(adc->prescaler) | (1 << ADATE);
+}
+
+void adc_scan_stop(adc_t *adc) {
+    (void)adc;
+    adc_stop_conversions();
+}
+
+uint8_t adc_scan_read(adc_t *adc, uint16_t *results) {
+    (void)adc;
+    uint8_t sreg = SREG;
+    cli();
+
+    const uint16_t *table = scan_table[scan_front];
+    for (uint8_t i = 0; i < scan_count; i++) {
+        results[i] = table[i];
+    }
+    uint8_t seq = scan_seq;
+
+    SREG = sreg;
+    return seq;
 }
 
 uint8_t adc_is_busy(adc_t *adc) {
     return adc->in_progress;
 }
 
+static void adc_ring_push(uint16_t value) {
+    uint8_t head = ring_head;
+    uint8_t next = (head + 1) & RING_MASK;
+
+    if (next == ring_tail) {
+        if (ring_overrun_count != 0xFF) {
+            ring_overrun_count++;
+        }
+        return;
+    }
+
+    ring_buf[head] = value;
+    ring_head = next;
+}
+
+/*
+ * ADIF is cleared by hardware when this vector runs. In free-running
+ * mode the next conversion is already under way, so this only has to
+ * finish within one conversion time (13 ADC clocks).
+ */
 ISR(ADC_vect) {
-    (void)ADC;
-    ADCSRA |= (1 << ADIF);
+    uint16_t value = ADC;
+
+    switch (adc_mode) {
+        case ADC_MODE_SINGLE:
+            if (single_discard) {
+                single_discard = 0;
+                ADCSRA |= (1 << ADSC);
+                break;
+            }
+            single_result = value;
+            single_done = 1;
+            adc_mode = ADC_MODE_IDLE;
+            ADCSRA &= ~(1 << ADIE);
+            break;
+
+        case ADC_MODE_FREE_RUN:
+            if (decim_factor == 1) {
+                adc_ring_push(value);
+                break;
+            }
+            decim_sum += value;
+            if (++decim_count == decim_factor) {
+                adc_ring_push(decim_sum / decim_factor);
+                decim_sum = 0;
+                decim_count = 0;
+            }
+            break;
+
+        case ADC_MODE_OVERSAMPLE:
+            os_sum += value;
+            if (--os_left == 0) {
+                adc_ring_push((uint16_t)(os_sum >> os_bits));
+                os_sum = 0;
+                os_left = os_count;
+            }
+            break;
+
+        case ADC_MODE_STREAM:
+            // The trigger is the rising edge of OCF0A. Nothing else
+            // clears it here, so clear it for the next compare match.
+            TIFR = (1 << OCF0A);
+
+            stream_buf[stream_pos] = value;
+            if (++stream_pos == stream_half) {
+                if (stream_on_half) {
+                    stream_on_half(stream_buf, stream_half);
+                }
+            } else if (stream_pos == stream_len) {
+                stream_pos = 0;
+                if (stream_on_full) {
+                    stream_on_full(stream_buf + stream_half, stream_half);
+                }
+            }
+            break;
+
+        case ADC_MODE_SCAN: {
+            /*
+             * MUX is latched when a conversion starts, and the next one
+             * started when this one finished. So this result is for
+             * scan_converting, the running conversion uses the channel
+             * queued last time, and ADMUX written now applies to the
+             * conversion after that. The first channel is converted twice
+             * at start; the second result just overwrites the first.
+             */
+            uint8_t done = scan_converting;
+            uint8_t next = scan_queued + 1;
+
+            if (next == scan_count) {
+                next = 0;
+            }
+            scan_converting = scan_queued;
+            scan_queued = next;
+            ADMUX = (ADMUX & 0xF0) | scan_channels[next];
+
+            scan_table[scan_front ^ 1][done] = value;
+            if (done == scan_count - 1) {
+                scan_front ^= 1;
+                if (++scan_seq == 0) {
+                    scan_seq = 1;
+                }
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
 }
@@ -0,0 +1,218 @@
+/**
+ * @file filter.c
+ * @brief Fixed-point streaming filters
+ */
+
+#include <stdint.h>
+#include "attiny85/dsp/filter.h"
+
+#if defined(__AVR_HAVE_MUL__)
+
+static inline int32_t filter_mul(int16_t x, int16_t c) {
+    return (int32_t)x * c;
+}
+
+#else
+
+/*
+ * 16 x 8 unsigned shift-and-add. The loop ends as soon as the remaining
+ * multiplier bits are zero, and the partial sum never needs more than
+ * 24 bits.
+ */
+static uint32_t filter_mul_u16x8(uint16_t a, uint8_t b) {
+    uint32_t acc = 0;
+    uint32_t addend = a;
+
+    while (b) {
+        if (b & 0x01) {
+            acc += addend;
+        }
+        addend <<= 1;
+        b >>= 1;
+    }
+    return acc;
+}
+
+/*
+ * No MUL on this core: multiply by the coefficient one byte at a time.
+ * Two 8-step loops replace libgcc's generic 32-bit multiply.
+ */
+static int32_t filter_mul(int16_t x, int16_t c) {
+    uint8_t negative = 0;
+    uint16_t ux = (uint16_t)x;
+    uint16_t uc = (uint16_t)c;
+
+    if (x < 0) {
+        ux = -ux;
+        negative = 1;
+    }
+    if (c < 0) {
+        uc = -uc;
+        negative ^= 1;
+    }
+
+    uint32_t product = filter_mul_u16x8(ux, (uint8_t)uc) +
+                       (filter_mul_u16x8(ux, (uint8_t)(uc >> 8)) << 8);
+
+    return negative ? -(int32_t)product : (int32_t)product;
+}
+
+#endif
+
+static int16_t filter_saturate(int32_t value) {
+    if (value > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (value < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)value;
+}
+
+filter_ema_t filter_ema_init(uint8_t shift) {
+    if (shift < 1) {
+        shift = 1;
+    } else if (shift > 15) {
+        shift = 15;
+    }
+
+    filter_ema_t f = {
+        .acc = 0,
+        .shift = shift,
+        .primed = 0
+    };
+    return f;
+}
+
+int16_t filter_ema(filter_ema_t *f, int16_t x) {
+    if (!f->primed) {
+        f->acc = (int32_t)x << f->shift;
+        f->primed = 1;
+        return x;
+    }
+
+    // acc holds y << shift, so acc += x - y is y += (x - y) >> shift
+    f->acc += x - (f->acc >> f->shift);
+    return (int16_t)(f->acc >> f->shift);
+}
+
+filter_ma_t filter_ma_init(int16_t *buf, uint8_t log2_len) {
+    if (log2_len > 7) {
+        log2_len = 7;
+    }
+
+    filter_ma_t f = {
+        .buf = buf,
+        .sum = 0,
+        .pos = 0,
+        .log2_len = log2_len,
+        .primed = 0
+    };
+    return f;
+}
+
+int16_t filter_ma(filter_ma_t *f, int16_t x) {
+    uint8_t len = 1 << f->log2_len;
+
+    // Fill the window with the first sample instead of ramping from 0
+    if (!f->primed) {
+        for (uint8_t i = 0; i < len; i++) {
+            f->buf[i] = x;
+        }
+        f->sum = (int32_t)x << f->log2_len;
+        f->primed = 1;
+    }
+
+    // int is 16 bits on AVR; inputs far apart would overflow the difference
+    f->sum += (int32_t)x - f->buf[f->pos];
+    f->buf[f->pos] = x;
+    f->pos = (f->pos + 1) & (len - 1);
+
+    return (int16_t)(f->sum >> f->log2_len);
+}
+
+filter_biquad_t filter_biquad_init(const filter_biquad_coeffs_t *coeffs) {
+    filter_biquad_t f = {
+        .c = *coeffs,
+        .x1 = 0,
+        .x2 = 0,
+        .y1 = 0,
+        .y2 = 0
+    };
+    return f;
+}
+
+int16_t filter_biquad(filter_biquad_t *f, int16_t x) {
+    // Q14 products; start from half an LSB so the shift rounds
+    int32_t acc = 1L << 13;
+
+    acc += filter_mul(x, f->c.b0);
+    acc += filter_mul(f->x1, f->c.b1);
+    acc += filter_mul(f->x2, f->c.b2);
+    acc -= filter_mul(f->y1, f->c.a1);
+    acc -= filter_mul(f->y2, f->c.a2);
+
+    int16_t y = filter_saturate(acc >> 14);
+
+    f->x2 = f->x1;
+    f->x1 = x;
+    f->y2 = f->y1;
+    f->y1 = y;
+    return y;
+}
+
+filter_median_t filter_median_init(uint8_t n) {
+    if (n < 3) {
+        n = 3;
+    } else if (n > FILTER_MEDIAN_MAX) {
+        n = FILTER_MEDIAN_MAX;
+    }
+    n |= 0x01;
+    if (n > FILTER_MEDIAN_MAX) {
+        n -= 2;
+    }
+
+    filter_median_t f = {
+        .n = n,
+        .pos = 0,
+        .primed = 0
+    };
+    return f;
+}
+
+int16_t filter_median(filter_median_t *f, int16_t x) {
+    uint8_t n = f->n;
+    uint8_t i;
+
+    if (!f->primed) {
+        for (i = 0; i < n; i++) {
+            f->hist[i] = x;
+            f->sorted[i] = x;
+        }
+        f->primed = 1;
+        return x;
+    }
+
+    int16_t old = f->hist[f->pos];
+    f->hist[f->pos] = x;
+    if (++f->pos == n) {
+        f->pos = 0;
+    }
+
+    // Find the oldest sample in the sorted copy and slide the new one
+    // into its place, shifting neighbours towards the gap
+    for (i = 0; f->sorted[i] != old; i++) {
+    }
+
+    while (i > 0 && f->sorted[i - 1] > x) {
+        f->sorted[i] = f->sorted[i - 1];
+        i--;
+    }
+    while (i < n - 1 && f->sorted[i + 1] < x) {
+        f->sorted[i] = f->sorted[i + 1];
+        i++;
+    }
+    f->sorted[i] = x;
+
+    return f->sorted[n / 2];
+}
@@ -0,0 +1,179 @@
+/**
+ * @file goertzel.c
+ * @brief Streaming Goertzel tone detector
+ */
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "attiny85/dsp/goertzel.h"
+
+#if defined(__AVR_HAVE_MUL__)
+
+static inline int32_t goertzel_mul(int32_t s, int16_t c) {
+    return (int32_t)(((int64_t)s * c) >> 14);
+}
+
+#else
+
+/*
+ * s * c / 2^14, i.e. s times 2 cos(w) with c in Q15. No MUL on this
+ * core: walk the coefficient bits from the bottom, adding s and halving
+ * the partial sum, so the sum never needs more than 32 bits.
+ */
+static int32_t goertzel_mul(int32_t s, int16_t c) {
+    uint8_t negative = 0;
+    uint16_t uc = (uint16_t)c;
+    int32_t acc = 0;
+
+    if (c < 0) {
+        uc = -uc;
+        negative = 1;
+    }
+
+    for (uint8_t i = 0; i < 14; i++) {
+        if (uc & 0x01) {
+            acc += s;
+        }
+        acc >>= 1;
+        uc >>= 1;
+    }
+    if (uc & 0x01) {
+        acc += s;
+    }
+
+    return negative ? -acc : acc;
+}
+
+#endif
+
+static uint16_t goertzel_isqrt(uint32_t x) {
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > x) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint16_t)root;
+}
+
+// Save the block result scaled to 14 bits, so goertzel_read() can square
+// it in 32 bits, and clear the resonator for the next block
+static void goertzel_latch(goertzel_tone_t *t) {
+    int32_t s1 = t->s1;
+    int32_t s2 = t->s2;
+    uint32_t m = (uint32_t)(s1 < 0 ? -s1 : s1) | (uint32_t)(s2 < 0 ? -s2 : s2);
+    uint8_t shift = 0;
+
+    while (m >= (1UL << 14)) {
+        m >>= 1;
+        shift++;
+    }
+
+    t->r1 = (int16_t)(s1 >> shift);
+    t->r2 = (int16_t)(s2 >> shift);
+    t->r_shift = shift;
+    t->s1 = 0;
+    t->s2 = 0;
+}
+
+goertzel_t goertzel_init(goertzel_tone_t *tones, uint8_t count, uint16_t block_len) {
+    if (block_len < 2) {
+        block_len = 2;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        // goertzel_mul() handles 15 magnitude bits; -32768 would read as 0
+        if (tones[i].coeff == INT16_MIN) {
+            tones[i].coeff = -32767;
+        }
+        tones[i].s1 = 0;
+        tones[i].s2 = 0;
+        tones[i].r1 = 0;
+        tones[i].r2 = 0;
+        tones[i].r_shift = 0;
+    }
+
+    goertzel_t g = {
+        .tones = tones,
+        .count = count,
+        .block_len = block_len,
+        .pos = 0,
+        .seq = 0
+    };
+    return g;
+}
+
+uint8_t goertzel_feed(goertzel_t *g, int16_t x) {
+    goertzel_tone_t *t = g->tones;
+
+    // s[n] = x[n] + 2 cos(w) s[n-1] - s[n-2]
+    for (uint8_t i = g->count; i; i--, t++) {
+        int32_t s = x + goertzel_mul(t->s1, t->coeff) - t->s2;
+        t->s2 = t->s1;
+        t->s1 = s;
+    }
+
+    if (++g->pos < g->block_len) {
+        return 0;
+    }
+
+    g->pos = 0;
+    t = g->tones;
+    for (uint8_t i = g->count; i; i--, t++) {
+        goertzel_latch(t);
+    }
+
+    uint8_t seq = g->seq + 1;
+    g->seq = seq ? seq : 1;
+    return 1;
+}
+
+uint8_t goertzel_read(goertzel_t *g, uint16_t *amplitudes) {
+    uint8_t seq;
+
+    // Retry if a block completes while the tones are being read
+    do {
+        seq = g->seq;
+
+        for (uint8_t i = 0; i < g->count; i++) {
+            goertzel_tone_t *t = &g->tones[i];
+
+            uint8_t sreg = SREG;
+            cli();
+            int16_t r1 = t->r1;
+            int16_t r2 = t->r2;
+            uint8_t shift = t->r_shift;
+            SREG = sreg;
+
+            // |X|^2 = s1^2 + s2^2 - 2 cos(w) s1 s2, all terms below 2^30
+            int32_t cross = ((int32_t)r2 * t->coeff) >> 15;
+            int32_t power = (int32_t)r1 * r1 + (int32_t)r2 * r2 - 2 * (int32_t)r1 * cross;
+            if (power < 0) {
+                power = 0;
+            }
+
+            // An on-bin tone of amplitude A gives |X| = A * N / 2
+            uint16_t root = goertzel_isqrt((uint32_t)power);
+            uint32_t amplitude = 0xFFFF;
+            if (shift < 16) {
+                amplitude = (((uint32_t)root << (shift + 1)) + g->block_len / 2) / g->block_len;
+                if (amplitude > 0xFFFF) {
+                    amplitude = 0xFFFF;
+                }
+            }
+            amplitudes[i] = (uint16_t)amplitude;
+        }
+    } while (seq != g->seq);
+
+    return seq;
+}
@@ -25,13 +25,15 @@ void uart_putc(uart_t *uart_ptr, uint8_t data) {
     PORTB &= ~tx_pin_mask;
     _delay_us(104);
 
-    // 8 data bits, LSB first
+    // 8 data bits, LSB first. A constant shift keeps every bit the same
+    // length; (1 << i) is a loop on AVR and stretches the later bits.
     for (i = 0; i < 8; i++) {
-        if (data & (1 << i)) {
+        if (data & 0x01) {
             PORTB |= tx_pin_mask;
         } else {
             PORTB &= ~tx_pin_mask;
         }
+        data >>= 1;
         _delay_us(104);
     }
 
@@ -62,8 +64,9 @@ uint8_t uart_getc(uart_t *uart_ptr, uint8_t *data, uint32_t timeout_us) {
             // Read 8 data bits, LSB first
             for (i = 0; i < 8; i++) {
                 _delay_us(104);
+                received_byte >>= 1;
                 if (PINB & rx_pin_mask) {
-                    received_byte |= (1 << i);
+                    received_byte |= 0x80;
                 }
             }
 
@@ -11,114 +11,250 @@
 #define USI_EXTERNAL_CLOCK ((1 << USICS1) | (0 << USICS0))
 #define USI_STROBE_CLOCK ((1 << USICLK) | (1 << USITC))
 
-static i2c_config_t config;
-
-static inline void usi_delay(void) {
-    uint8_t i;
-    for (i = 0; i < 10; i++) {
-        __builtin_avr_delay_cycles(1);
+#define USISR_CLEAR_FLAGS ((1 << USISIF) | (1 << USIOIF) | (1 << USIPF) | (1 << USIDC))
+#define USISR_8BIT  (USISR_CLEAR_FLAGS | (0x0 << USICNT0))
+#define USISR_1BIT  (USISR_CLEAR_FLAGS | (0xE << USICNT0))
+
+// Approximate cycles per iteration of the SCL wait loop
+#define SCL_POLL_CYCLES 8
+
+// Nanoseconds to CPU cycles, rounded up
+#define I2C_NS_TO_CYCLES(ns) ((((F_CPU / 1000UL) * (ns)) + 999999UL) / 1000000UL)
+
+// Cycles the bit loop itself spends in each SCL phase (strobe, SCL
+// poll, USIOIF check, speed dispatch), taken off the padding delay
+#define I2C_LOW_OVERHEAD    10
+#define I2C_HIGH_OVERHEAD   12
+
+#define I2C_PAD(ns, overhead) \
+    (I2C_NS_TO_CYCLES(ns) > (overhead) ? I2C_NS_TO_CYCLES(ns) - (overhead) : 0)
+
+/*
+ * SCL low/high times per speed. Each pair adds up to the nominal period
+ * and stays above the spec minimums (tLOW/tHIGH 4.7/4.0 us standard,
+ * 1.3/0.6 us fast, 0.5/0.26 us fast plus). START/STOP setup and hold
+ * use the high time, bus free time uses the low time.
+ */
+#define I2C_100K_LOW_NS     5200
+#define I2C_100K_HIGH_NS    4800
+#define I2C_400K_LOW_NS     1400
+#define I2C_400K_HIGH_NS    1100
+#define I2C_1M_LOW_NS       550
+#define I2C_1M_HIGH_NS      450
+
+static inline void i2c_delay_low(i2c_t *i2c) {
+    switch (i2c->config.speed) {
+        case I2C_SPEED_400K:
+            __builtin_avr_delay_cycles(I2C_PAD(I2C_400K_LOW_NS, I2C_LOW_OVERHEAD));
+            break;
+        case I2C_SPEED_1M:
+            __builtin_avr_delay_cycles(I2C_PAD(I2C_1M_LOW_NS, I2C_LOW_OVERHEAD));
+            break;
+        default:
+            __builtin_avr_delay_cycles(I2C_PAD(I2C_100K_LOW_NS, I2C_LOW_OVERHEAD));
+            break;
     }
 }
 
-static void i2c_release_scl(void) {
-    DDRB &= ~SCL_PIN;
-    PORTB |= SCL_PIN;
+static inline void i2c_delay_high(i2c_t *i2c) {
+    switch (i2c->config.speed) {
+        case I2C_SPEED_400K:
+            __builtin_avr_delay_cycles(I2C_PAD(I2C_400K_HIGH_NS, I2C_HIGH_OVERHEAD));
+            break;
+        case I2C_SPEED_1M:
+            __builtin_avr_delay_cycles(I2C_PAD(I2C_1M_HIGH_NS, I2C_HIGH_OVERHEAD));
+            break;
+        default:
+            __builtin_avr_delay_cycles(I2C_PAD(I2C_100K_HIGH_NS, I2C_HIGH_OVERHEAD));
+            break;
+    }
 }
 
-static void i2c_release_sda(void) {
-    DDRB &= ~SDA_PIN;
-    PORTB |= SDA_PIN;
+/*
+ * SCL is released and may be held low by a slave stretching the clock.
+ * Every wait for it is bounded by the configured timeout.
+ */
+static uint8_t i2c_wait_scl_high(i2c_t *i2c) {
+    uint16_t loops = i2c->scl_timeout;
+
+    while (!(PINB & SCL_PIN)) {
+        if (!--loops) {
+            return 0;
+        }
+    }
+    return 1;
 }
 
-static void i2c_drive_scl_low(void) {
-    DDRB |= SCL_PIN;
-    PORTB &= ~SCL_PIN;
+// Leave both lines released and the USI ready for the next START
+static void i2c_release_bus(void) {
+    USIDR = 0xFF;
+    PORTB |= SDA_PIN | SCL_PIN;
+    DDRB |= SDA_PIN | SCL_PIN;
+    USISR = USISR_CLEAR_FLAGS;
 }
 
-static void i2c_drive_sda_low(void) {
-    DDRB |= SDA_PIN;
-    PORTB &= ~SDA_PIN;
-}
+i2c_t i2c_init(i2c_config_t cfg) {
+    i2c_t i2c = { .config = cfg };
+    uint32_t timeout_us = cfg.timeout_us ? cfg.timeout_us : I2C_DEFAULT_TIMEOUT_US;
+    uint32_t loops = timeout_us * (F_CPU / 1000000UL) / SCL_POLL_CYCLES;
 
-static void i2c_drive_sda_high(void) {
-    DDRB |= SDA_PIN;
-    PORTB |= SDA_PIN;
+    if (loops == 0) {
+        loops = 1;
+    } else if (loops > 0xFFFF) {
+        loops = 0xFFFF;
+    }
+    i2c.scl_timeout = (uint16_t)loops;
+
+    // Two-wire mode: a pin is pulled low when its PORTB bit is 0 or,
+    // for SDA, when the USIDR MSB is 0. Both released here.
+    i2c_release_bus();
+    USICR = USI_2WIRE_MODE | USI_EXTERNAL_CLOCK | (1 << USICLK);
+
+    return i2c;
 }
 
-i2c_t i2c_init(i2c_config_t cfg) {
-    config = cfg;
+i2c_status_t i2c_recover(i2c_t *i2c) {
+    uint8_t i;
 
-    i2c_release_scl();
-    i2c_release_sda();
+    i2c_release_bus();
 
-    _delay_ms(1);
+    if (!i2c_wait_scl_high(i2c)) {
+        return I2C_ERR_TIMEOUT;
+    }
 
-    i2c_t i2c = { .config = cfg };
-    return i2c;
+    // A slave interrupted mid-byte keeps SDA low until it has shifted
+    // out the rest of its byte; nine clocks cover any bit position
+    for (i = 0; i < 9 && !(PINB & SDA_PIN); i++) {
+        PORTB &= ~SCL_PIN;
+        i2c_delay_low(i2c);
+        PORTB |= SCL_PIN;
+        if (!i2c_wait_scl_high(i2c)) {
+            return I2C_ERR_TIMEOUT;
+        }
+        i2c_delay_high(i2c);
+    }
+
+    if (!(PINB & SDA_PIN)) {
+        return I2C_ERR_BUS_ERROR;
+    }
+
+    // STOP: SDA low while SCL is low, then SCL high, then SDA high
+    PORTB &= ~SCL_PIN;
+    i2c_delay_low(i2c);
+    PORTB &= ~SDA_PIN;
+    i2c_delay_low(i2c);
+    PORTB |= SCL_PIN;
+    if (!i2c_wait_scl_high(i2c)) {
+        return I2C_ERR_TIMEOUT;
+    }
+    i2c_delay_high(i2c);
+    PORTB |= SDA_PIN;
+    i2c_delay_low(i2c);
+
+    USISR = USISR_CLEAR_FLAGS;
+
+    return I2C_OK;
 }
 
 i2c_status_t i2c_start(i2c_t *i2c) {
-    i2c_release_scl();
-    i2c_release_sda();
-    usi_delay();
+    // Repeated START: SCL is still low after the last ACK bit
+    if (!(PINB & SCL_PIN)) {
+        i2c_delay_low(i2c);
+    }
+    PORTB |= SCL_PIN;
+    if (!i2c_wait_scl_high(i2c)) {
+        i2c_release_bus();
+        return I2C_ERR_TIMEOUT;
+    }
+
+    if (!(PINB & SDA_PIN)) {
+        i2c_status_t status = i2c_recover(i2c);
+        if (status != I2C_OK) {
+            return status;
+        }
+    }
+
+    USISR = USISR_CLEAR_FLAGS;
+    i2c_delay_high(i2c);
 
-    i2c_drive_sda_low();
-    usi_delay();
+    PORTB &= ~SDA_PIN;
+    i2c_delay_high(i2c);
+    PORTB &= ~SCL_PIN;
+    PORTB |= SDA_PIN;
 
-    i2c_drive_scl_low();
-    usi_delay();
+    if (!(USISR & (1 << USISIF))) {
+        i2c_release_bus();
+        return I2C_ERR_BUS_ERROR;
+    }
 
     return I2C_OK;
 }
 
 i2c_status_t i2c_stop(i2c_t *i2c) {
-    i2c_drive_sda_low();
-    usi_delay();
-
-    i2c_release_scl();
-    usi_delay();
+    PORTB &= ~SDA_PIN;
+    i2c_delay_low(i2c);
+    PORTB |= SCL_PIN;
+    if (!i2c_wait_scl_high(i2c)) {
+        i2c_release_bus();
+        return I2C_ERR_TIMEOUT;
+    }
+    i2c_delay_high(i2c);
+    PORTB |= SDA_PIN;
+    i2c_delay_low(i2c);
 
-    i2c_release_sda();
-    usi_delay();
+    if (!(USISR & (1 << USIPF))) {
+        return I2C_ERR_BUS_ERROR;
+    }
 
     return I2C_OK;
 }
 
-static uint8_t i2c_write_byte_usi(i2c_t *i2c, uint8_t data) {
-    uint8_t tempUSISR;
+/*
+ * Clocks bits until the USI counter overflows: 16 edges for a byte,
+ * 2 for the ACK bit. Returns the shifted-in data and leaves SDA released
+ * with SCL low. The SCL low time comes from the delay before each rising
+ * edge, so back-to-back calls, START and STOP each add exactly one.
+ */
+static i2c_status_t i2c_transfer(i2c_t *i2c, uint8_t usisr, uint8_t *data) {
+    uint8_t strobe = USI_2WIRE_MODE | USI_EXTERNAL_CLOCK | USI_STROBE_CLOCK;
 
-    USIDR = data;
-    USISR = (1 << USISIF) | (1 << USIOIF) | (1 << USIPF) | (1 << USIDC) | (0x0 << USICNT0);
-
-    tempUSISR = USI_2WIRE_MODE | USI_EXTERNAL_CLOCK | USI_STROBE_CLOCK;
+    USISR = usisr;
 
     do {
-        USICR = tempUSISR;
-        while (!(PINB & SCL_PIN));
-        USICR = tempUSISR;
-        while (PINB & SCL_PIN);
-        usi_delay();
+        i2c_delay_low(i2c);
+        USICR = strobe;
+        if (!i2c_wait_scl_high(i2c)) {
+            i2c_release_bus();
+            return I2C_ERR_TIMEOUT;
+        }
+        i2c_delay_high(i2c);
+        USICR = strobe;
     } while (!(USISR & (1 << USIOIF)));
 
-    DDRB &= ~SDA_PIN;
-    PORTB |= SDA_PIN;
-
+    *data = USIDR;
     USIDR = 0xFF;
-    USISR = (1 << USISIF) | (1 << USIOIF) | (1 << USIPF) | (1 << USIDC) | (0xE << USICNT0);
-
-    tempUSISR = USI_2WIRE_MODE | USI_EXTERNAL_CLOCK | USI_STROBE_CLOCK;
+    DDRB |= SDA_PIN;
 
-    USICR = tempUSISR;
-    while (!(PINB & SCL_PIN));
+    return I2C_OK;
+}
 
-    uint8_t ack = (PINB & SDA_PIN) ? 1 : 0;
+static i2c_status_t i2c_write_byte_usi(i2c_t *i2c, uint8_t data) {
+    i2c_status_t status;
+    uint8_t ack;
 
-    USICR = tempUSISR;
-    while (PINB & SCL_PIN);
+    USIDR = data;
+    status = i2c_transfer(i2c, USISR_8BIT, &ack);
+    if (status != I2C_OK) {
+        return status;
+    }
 
-    DDRB |= SDA_PIN;
+    DDRB &= ~SDA_PIN;
+    status = i2c_transfer(i2c, USISR_1BIT, &ack);
+    if (status != I2C_OK) {
+        return status;
+    }
 
-    return ack ? I2C_ERR_NACK : I2C_OK;
+    return (ack & 0x01) ? I2C_ERR_NACK : I2C_OK;
 }
 
 i2c_status_t i2c_write_byte(i2c_t *i2c, uint8_t data) {
@@ -129,44 +265,23 @@ i2c_status_t i2c_write_byte_wait_ack(i2c_t *i2c, uint8_t data) {
     return i2c_write_byte_usi(i2c, data);
 }
 
-static uint8_t i2c_read_byte_usi(i2c_t *i2c, uint8_t ack) {
-    uint8_t tempUSISR;
-
-    USIDR = 0xFF;
-    USISR = (1 << USISIF) | (1 << USIOIF) | (1 << USIPF) | (1 << USIDC) | (0x0 << USICNT0);
+static i2c_status_t i2c_read_byte_usi(i2c_t *i2c, uint8_t *data, uint8_t last) {
+    i2c_status_t status;
+    uint8_t dummy;
 
     DDRB &= ~SDA_PIN;
-    PORTB |= SDA_PIN;
-
-    tempUSISR = USI_2WIRE_MODE | USI_EXTERNAL_CLOCK | USI_STROBE_CLOCK;
-
-    do {
-        USICR = tempUSISR;
-        while (!(PINB & SCL_PIN));
-        USICR = tempUSISR;
-        while (PINB & SCL_PIN);
-        usi_delay();
-    } while (!(USISR & (1 << USIOIF)));
-
-    uint8_t data = USIDR;
-
-    USIDR = ack ? 0xFF : 0x00;
-    USISR = (1 << USISIF) | (1 << USIOIF) | (1 << USIPF) | (1 << USIDC) | (0xE << USICNT0);
-
-    USICR = tempUSISR;
-    while (!(PINB & SCL_PIN));
-    USICR = tempUSISR;
-    while (PINB & SCL_PIN);
-
-    DDRB |= SDA_PIN;
-    PORTB |= SDA_PIN;
+    status = i2c_transfer(i2c, USISR_8BIT, data);
+    if (status != I2C_OK) {
+        return status;
+    }
 
-    return data;
+    // ACK pulls SDA low; the last byte of a read is NACKed
+    USIDR = last ? 0xFF : 0x00;
+    return i2c_transfer(i2c, USISR_1BIT, &dummy);
 }
 
 i2c_status_t i2c_read_byte(i2c_t *i2c, uint8_t *data) {
-    *data = i2c_read_byte_usi(i2c, 0);
-    return I2C_OK;
+    return i2c_read_byte_usi(i2c, data, 0);
 }
 
 i2c_status_t i2c_address(i2c_t *i2c, uint8_t address, uint8_t read_write) {
@@ -179,38 +294,71 @@ i2c_status_t i2c_address(i2c_t *i2c, uint8_t address, uint8_t read_write) {
     return i2c_write_byte(i2c, addr_byte);
 }
 
-i2c_status_t i2c_read_reg(i2c_t *i2c, uint8_t address, uint8_t reg, uint8_t *data) {
+// NACK ends the transaction with a STOP. A timeout has already released
+// both lines, and bus errors leave the bus alone
+static i2c_status_t i2c_abort(i2c_t *i2c, i2c_status_t status) {
+    if (status == I2C_ERR_NACK) {
+        i2c_stop(i2c);
+    }
+    return status;
+}
+
+i2c_status_t i2c_write_read(i2c_t *i2c, uint8_t address, const uint8_t *tx, uint8_t tx_len,
+                            uint8_t *rx, uint8_t rx_len) {
     i2c_status_t status;
+    uint8_t i;
 
-    status = i2c_address(i2c, address, 0);
-    if (status != I2C_OK) return status;
+    if (tx_len || !rx_len) {
+        status = i2c_address(i2c, address, 0);
+        if (status != I2C_OK) return i2c_abort(i2c, status);
 
-    status = i2c_write_byte(i2c, reg);
-    if (status != I2C_OK) return status;
+        for (i = 0; i < tx_len; i++) {
+            status = i2c_write_byte(i2c, tx[i]);
+            if (status != I2C_OK) return i2c_abort(i2c, status);
+        }
+    }
 
-    status = i2c_start(i2c);
-    if (status != I2C_OK) return status;
+    if (rx_len) {
+        // Repeated START (or first START for a pure read)
+        status = i2c_address(i2c, address, 1);
+        if (status != I2C_OK) return i2c_abort(i2c, status);
 
-    status = i2c_address(i2c, address, 1);
-    if (status != I2C_OK) return status;
+        for (i = 0; i < rx_len; i++) {
+            status = i2c_read_byte_usi(i2c, &rx[i], i == rx_len - 1);
+            if (status != I2C_OK) return i2c_abort(i2c, status);
+        }
+    }
 
-    *data = i2c_read_byte_usi(i2c, 1);
-    i2c_stop(i2c);
-    return I2C_OK;
+    return i2c_stop(i2c);
 }
 
-i2c_status_t i2c_write_reg(i2c_t *i2c, uint8_t address, uint8_t reg, uint8_t data) {
+i2c_status_t i2c_read_regs(i2c_t *i2c, uint8_t address, uint8_t reg, uint8_t *data, uint8_t len) {
+    return i2c_write_read(i2c, address, &reg, 1, data, len);
+}
+
+i2c_status_t i2c_write_regs(i2c_t *i2c, uint8_t address, uint8_t reg, const uint8_t *data,
+                            uint8_t len) {
     i2c_status_t status;
+    uint8_t i;
 
     status = i2c_address(i2c, address, 0);
-    if (status != I2C_OK) return status;
+    if (status != I2C_OK) return i2c_abort(i2c, status);
 
     status = i2c_write_byte(i2c, reg);
-    if (status != I2C_OK) return status;
+    if (status != I2C_OK) return i2c_abort(i2c, status);
 
-    status = i2c_write_byte(i2c, data);
-    if (status != I2C_OK) return status;
+    for (i = 0; i < len; i++) {
+        status = i2c_write_byte(i2c, data[i]);
+        if (status != I2C_OK) return i2c_abort(i2c, status);
+    }
 
-    i2c_stop(i2c);
-    return I2C_OK;
+    return i2c_stop(i2c);
+}
+
+i2c_status_t i2c_read_reg(i2c_t *i2c, uint8_t address, uint8_t reg, uint8_t *data) {
+    return i2c_read_regs(i2c, address, reg, data, 1);
+}
+
+i2c_status_t i2c_write_reg(i2c_t *i2c, uint8_t address, uint8_t reg, uint8_t data) {
+    return i2c_write_regs(i2c, address, reg, &data, 1);
 }
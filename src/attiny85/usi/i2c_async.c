@@ -0,0 +1,338 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "attiny85/usi/i2c_async.h"
+#include "attiny85/timer/timer0.h"
+
+#define SDA_PIN     (1 << PB0)
+#define SCL_PIN     (1 << PB2)
+
+#define USI_2WIRE_MODE   ((1 << USIWM1) | (0 << USIWM0))
+#define USI_EXTERNAL_CLOCK ((1 << USICS1) | (0 << USICS0))
+#define USICR_ASYNC (USI_2WIRE_MODE | USI_EXTERNAL_CLOCK | (1 << USICLK) | (1 << USIOIE))
+
+#define USISR_CLEAR_FLAGS ((1 << USISIF) | (1 << USIOIF) | (1 << USIPF) | (1 << USIDC))
+#define USISR_8BIT  (USISR_CLEAR_FLAGS | (0x0 << USICNT0))
+#define USISR_1BIT  (USISR_CLEAR_FLAGS | (0xE << USICNT0))
+
+// What the Timer0 compare ISR does on its next tick
+typedef enum {
+    PHASE_IDLE,
+    PHASE_START,        // both lines released: pull SDA low
+    PHASE_START_HOLD,   // pull SCL low, load the address byte
+    PHASE_SHIFT,        // strobe SCL until the USI counter overflows
+    PHASE_RESTART,      // SDA released, SCL low: release SCL
+    PHASE_STOP,         // SDA and SCL low: release SCL
+    PHASE_STOP_HOLD,    // release SDA
+    PHASE_BUS_FREE,     // bus free time, then complete
+} i2c_async_phase_t;
+
+// What the USI overflow ISR just finished
+typedef enum {
+    BIT_TX_BYTE,
+    BIT_TX_ACK,
+    BIT_RX_BYTE,
+    BIT_RX_ACK,
+} i2c_async_bits_t;
+
+static uint8_t timer_top;
+static uint8_t timer_prescaler;
+static uint16_t stretch_ticks;
+
+static i2c_xfer_t *volatile queue_head;
+static i2c_xfer_t *queue_tail;
+
+static volatile uint8_t phase;
+static uint8_t bits;
+static uint8_t reading;
+static uint16_t stretch_left;
+static i2c_status_t result;
+
+static const uint8_t *tx_ptr;
+static uint8_t tx_left;
+static uint8_t *rx_ptr;
+static uint8_t rx_left;
+
+static void i2c_async_begin(i2c_xfer_t *xfer) {
+    tx_ptr = xfer->tx;
+    tx_left = xfer->tx_len;
+    rx_ptr = xfer->rx;
+    rx_left = xfer->rx_len;
+
+    // A read-only transaction skips the write phase and its restart
+    reading = (tx_left == 0 && rx_left != 0);
+    result = I2C_OK;
+    stretch_left = stretch_ticks;
+    phase = PHASE_START;
+}
+
+static void i2c_async_timer_stop(void) {
+    TCCR0B = 0;
+    TIMSK &= ~(1 << OCIE0A);
+}
+
+static void i2c_async_complete(i2c_status_t status) {
+    i2c_xfer_t *xfer = queue_head;
+
+    queue_head = xfer->next;
+    if (queue_head) {
+        i2c_async_begin(queue_head);
+    } else {
+        queue_tail = NULL;
+        phase = PHASE_IDLE;
+        i2c_async_timer_stop();
+    }
+
+    xfer->status = status;
+    if (xfer->callback) {
+        xfer->callback(xfer);
+    }
+}
+
+// Timeouts and bus errors: let go of both lines without a STOP
+static void i2c_async_release(i2c_status_t status) {
+    USIDR = 0xFF;
+    PORTB |= SDA_PIN | SCL_PIN;
+    DDRB |= SDA_PIN | SCL_PIN;
+    USISR = USISR_CLEAR_FLAGS;
+    i2c_async_complete(status);
+}
+
+// Called with SCL low: SDA low now, SCL then SDA released on later ticks
+static void i2c_async_stop(i2c_status_t status) {
+    result = status;
+    USIDR = 0xFF;
+    PORTB &= ~SDA_PIN;
+    DDRB |= SDA_PIN;
+    USISR = USISR_CLEAR_FLAGS;
+    phase = PHASE_STOP;
+}
+
+// Called with SCL low after an address, data or ACK bit
+static void i2c_async_next(void) {
+    USIDR = 0xFF;
+
+    if (tx_left && !reading) {
+        USIDR = *tx_ptr++;
+        tx_left--;
+        DDRB |= SDA_PIN;
+        USISR = USISR_8BIT;
+        bits = BIT_TX_BYTE;
+        return;
+    }
+
+    if (!reading && rx_left) {
+        reading = 1;
+        PORTB |= SDA_PIN;
+        DDRB |= SDA_PIN;
+        USISR = USISR_CLEAR_FLAGS;
+        phase = PHASE_RESTART;
+        return;
+    }
+
+    if (rx_left) {
+        DDRB &= ~SDA_PIN;
+        USISR = USISR_8BIT;
+        bits = BIT_RX_BYTE;
+        return;
+    }
+
+    i2c_async_stop(I2C_OK);
+}
+
+uint32_t i2c_async_init(i2c_t *i2c) {
+    uint32_t hz;
+    uint32_t half;
+    uint32_t ticks;
+
+    switch (i2c->config.speed) {
+        case I2C_SPEED_400K:
+            hz = 400000UL;
+            break;
+        case I2C_SPEED_1M:
+            hz = 1000000UL;
+            break;
+        default:
+            hz = 100000UL;
+            break;
+    }
+
+    half = F_CPU / 2 / hz;
+    if (half < I2C_ASYNC_MIN_HALF_CYCLES) {
+        half = I2C_ASYNC_MIN_HALF_CYCLES;
+    }
+
+    if (half > 256) {
+        ticks = (half + 7) / 8;
+        if (ticks > 256) {
+            ticks = 256;
+        }
+        timer_prescaler = TIMER0_PRESCALER_8;
+        timer_top = (uint8_t)(ticks - 1);
+        half = ticks * 8;
+    } else {
+        timer_prescaler = TIMER0_PRESCALER_1;
+        timer_top = (uint8_t)(half - 1);
+    }
+
+    uint32_t timeout_us = i2c->config.timeout_us ? i2c->config.timeout_us : I2C_DEFAULT_TIMEOUT_US;
+    ticks = timeout_us * (F_CPU / 1000000UL) / half;
+    if (ticks == 0) {
+        ticks = 1;
+    } else if (ticks > 0xFFFF) {
+        ticks = 0xFFFF;
+    }
+    stretch_ticks = (uint16_t)ticks;
+
+    return F_CPU / 2 / half;
+}
+
+void i2c_async_submit(i2c_t *i2c, i2c_xfer_t *xfer) {
+    (void)i2c;
+
+    xfer->status = I2C_PENDING;
+    xfer->next = NULL;
+
+    uint8_t sreg = SREG;
+    cli();
+
+    if (queue_tail) {
+        queue_tail->next = xfer;
+        queue_tail = xfer;
+    } else {
+        queue_head = queue_tail = xfer;
+        i2c_async_begin(xfer);
+
+        // Both lines released, overflow interrupt on
+        USIDR = 0xFF;
+        PORTB |= SDA_PIN | SCL_PIN;
+        DDRB |= SDA_PIN | SCL_PIN;
+        USISR = USISR_CLEAR_FLAGS;
+        USICR = USICR_ASYNC;
+
+        TCCR0B = 0;
+        TCCR0A = (1 << WGM01);
+        TCNT0 = 0;
+        OCR0A = timer_top;
+        TIFR = (1 << OCF0A);
+        TIMSK |= (1 << OCIE0A);
+        TCCR0B = timer_prescaler;
+    }
+
+    SREG = sreg;
+}
+
+uint8_t i2c_async_is_busy(i2c_t *i2c) {
+    (void)i2c;
+    return queue_head != NULL;
+}
+
+/*
+ * One SCL half period per compare match. A released SCL that still
+ * reads low is a slave stretching the clock, so the tick is skipped.
+ * During a byte the strobe is also held back while a finished byte is
+ * waiting for the overflow ISR, which stretches SCL low instead of
+ * clocking an unprepared bit.
+ */
+ISR(TIMER0_COMPA_vect) {
+    if ((PORTB & SCL_PIN) && !(PINB & SCL_PIN)) {
+        if (!--stretch_left) {
+            i2c_async_release(I2C_ERR_TIMEOUT);
+        }
+        return;
+    }
+    stretch_left = stretch_ticks;
+
+    switch (phase) {
+        case PHASE_SHIFT:
+            if (!(USISR & (1 << USIOIF))) {
+                USICR = USICR_ASYNC | (1 << USITC);
+            }
+            break;
+
+        case PHASE_START:
+            if (!(PINB & SDA_PIN)) {
+                i2c_async_release(I2C_ERR_BUS_ERROR);
+                break;
+            }
+            PORTB &= ~SDA_PIN;
+            phase = PHASE_START_HOLD;
+            break;
+
+        case PHASE_START_HOLD:
+            PORTB &= ~SCL_PIN;
+            USIDR = (queue_head->address << 1) | reading;
+            PORTB |= SDA_PIN;
+            DDRB |= SDA_PIN;
+            USISR = USISR_8BIT;
+            bits = BIT_TX_BYTE;
+            phase = PHASE_SHIFT;
+            break;
+
+        case PHASE_RESTART:
+            PORTB |= SCL_PIN;
+            phase = PHASE_START;
+            break;
+
+        case PHASE_STOP:
+            PORTB |= SCL_PIN;
+            phase = PHASE_STOP_HOLD;
+            break;
+
+        case PHASE_STOP_HOLD:
+            PORTB |= SDA_PIN;
+            phase = PHASE_BUS_FREE;
+            break;
+
+        case PHASE_BUS_FREE:
+            if (result == I2C_OK && !(USISR & (1 << USIPF))) {
+                result = I2C_ERR_BUS_ERROR;
+            }
+            USISR = USISR_CLEAR_FLAGS;
+            i2c_async_complete(result);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*
+ * Runs with SCL low after the last edge of a byte (16 edges) or an ACK
+ * bit (2 edges). Every path rewrites USISR, which clears USIOIF and
+ * lets the compare ISR strobe again.
+ */
+ISR(USI_OVF_vect) {
+    uint8_t data = USIDR;
+
+    switch (bits) {
+        case BIT_TX_BYTE:
+            DDRB &= ~SDA_PIN;
+            USISR = USISR_1BIT;
+            bits = BIT_TX_ACK;
+            return;
+
+        case BIT_TX_ACK:
+            if (data & 0x01) {
+                i2c_async_stop(I2C_ERR_NACK);
+                return;
+            }
+            break;
+
+        case BIT_RX_BYTE:
+            *rx_ptr++ = data;
+            rx_left--;
+            // ACK pulls SDA low; the last byte of a read is NACKed
+            USIDR = rx_left ? 0x00 : 0xFF;
+            DDRB |= SDA_PIN;
+            USISR = USISR_1BIT;
+            bits = BIT_RX_ACK;
+            return;
+
+        default:
+            break;
+    }
+
+    i2c_async_next();
+}
@@ -0,0 +1,221 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "attiny85/usi/i2c_slave.h"
+
+#define SDA_PIN     (1 << PB0)
+#define SCL_PIN     (1 << PB2)
+
+// Two-wire mode, clocked by SCL. USIWM0 adds SCL hold on counter
+// overflow while a transaction addressed to us is in progress.
+#define USICR_IDLE   ((1 << USISIE) | (1 << USIWM1) | (1 << USICS1))
+#define USICR_ACTIVE (USICR_IDLE | (1 << USIOIE) | (1 << USIWM0))
+
+// USISIF is left alone so a START that arrives meanwhile is not lost
+#define USISR_CLEAR_FLAGS ((1 << USIOIF) | (1 << USIPF) | (1 << USIDC))
+#define USISR_8BIT  (USISR_CLEAR_FLAGS | (0x0 << USICNT0))
+#define USISR_1BIT  (USISR_CLEAR_FLAGS | (0xE << USICNT0))
+
+// Cycles per pass of the wait for SCL to fall after a START
+#define START_POLL_CYCLES 8
+#define START_WAIT_LOOPS \
+    ((uint16_t)((uint32_t)I2C_SLAVE_START_TIMEOUT_US * (F_CPU / 1000000UL) / START_POLL_CYCLES))
+
+typedef enum {
+    STATE_CHECK_ADDRESS,
+    STATE_SEND_DATA,
+    STATE_REQUEST_REPLY,
+    STATE_CHECK_REPLY,
+    STATE_REQUEST_DATA,
+    STATE_GET_DATA,
+} i2c_slave_state_t;
+
+static i2c_slave_config_t config;
+
+static uint8_t state;
+static uint8_t reg_ptr;
+static uint8_t reg_ptr_next;    // Next written byte is the register pointer
+
+static volatile uint8_t write_pending;
+static volatile uint8_t write_ended;
+static uint8_t write_lo;
+static uint8_t write_hi;
+
+static void i2c_slave_idle(void) {
+    DDRB &= ~SDA_PIN;
+    USICR = USICR_IDLE;
+    USISR = USISR_CLEAR_FLAGS;
+}
+
+// Drive an ACK (SDA low) for one bit
+static void i2c_slave_ack(void) {
+    USIDR = 0;
+    DDRB |= SDA_PIN;
+    USISR = USISR_1BIT;
+}
+
+static void i2c_slave_store(uint8_t data) {
+    uint8_t reg = reg_ptr;
+    uint8_t mask = config.write_mask ? config.write_mask[reg] : 0xFF;
+
+    config.regs[reg] = (config.regs[reg] & ~mask) | (data & mask);
+
+    if (!write_pending) {
+        write_lo = write_hi = reg;
+        write_pending = 1;
+    } else if (reg < write_lo) {
+        write_lo = reg;
+    } else if (reg > write_hi) {
+        write_hi = reg;
+    }
+
+    if (++reg_ptr >= config.size) {
+        reg_ptr = 0;
+    }
+}
+
+i2c_slave_t i2c_slave_init(i2c_slave_config_t cfg) {
+    config = cfg;
+
+    reg_ptr = 0;
+    write_pending = 0;
+    write_ended = 0;
+
+    // SCL is an output so the USI can hold it; PORTB high leaves both
+    // lines released
+    PORTB |= SDA_PIN | SCL_PIN;
+    DDRB |= SCL_PIN;
+    DDRB &= ~SDA_PIN;
+
+    USICR = USICR_IDLE;
+    USISR = USISR_CLEAR_FLAGS | (1 << USISIF);
+
+    i2c_slave_t slave = { .config = cfg };
+    return slave;
+}
+
+void i2c_slave_deinit(i2c_slave_t *slave) {
+    (void)slave;
+    USICR = 0;
+    DDRB &= ~(SDA_PIN | SCL_PIN);
+}
+
+void i2c_slave_poll(i2c_slave_t *slave) {
+    uint8_t lo;
+    uint8_t hi;
+
+    if (!write_pending) {
+        return;
+    }
+
+    uint8_t sreg = SREG;
+    cli();
+
+    // USIPF stays set after a STOP until the next START clears it
+    if (!write_ended && !(USISR & (1 << USIPF))) {
+        SREG = sreg;
+        return;
+    }
+
+    lo = write_lo;
+    hi = write_hi;
+    write_pending = 0;
+    write_ended = 0;
+    SREG = sreg;
+
+    if (slave->config.on_write) {
+        slave->config.on_write(lo, hi - lo + 1);
+    }
+}
+
+/*
+ * The START is complete once SCL goes low. If SDA rises first it was a
+ * STOP instead, and the USI goes back to waiting for a START. So does a
+ * bus that keeps SCL high and SDA low past I2C_SLAVE_START_TIMEOUT_US.
+ */
+ISR(USI_START_vect) {
+    uint16_t loops = START_WAIT_LOOPS;
+
+    state = STATE_CHECK_ADDRESS;
+    DDRB &= ~SDA_PIN;
+
+    while ((PINB & SCL_PIN) && !(PINB & SDA_PIN)) {
+        if (--loops == 0) {
+            break;
+        }
+    }
+
+    if (write_pending) {
+        write_ended = 1;
+    }
+
+    USICR = (loops && !(PINB & SDA_PIN)) ? USICR_ACTIVE : USICR_IDLE;
+    USISR = USISR_CLEAR_FLAGS | (1 << USISIF);
+}
+
+/*
+ * SCL is held low from the overflow until USISR is written, so every
+ * path sets up the next phase first and does its bookkeeping after.
+ */
+ISR(USI_OVF_vect) {
+    uint8_t data = USIDR;
+
+    switch (state) {
+        case STATE_CHECK_ADDRESS:
+            if ((data >> 1) != config.address) {
+                i2c_slave_idle();
+                return;
+            }
+            i2c_slave_ack();
+            if (data & 0x01) {
+                state = STATE_SEND_DATA;
+            } else {
+                state = STATE_REQUEST_DATA;
+                reg_ptr_next = 1;
+            }
+            return;
+
+        case STATE_CHECK_REPLY:
+            // NACK: the master has read its last byte
+            if (data & 0x01) {
+                i2c_slave_idle();
+                return;
+            }
+            // fall through
+
+        case STATE_SEND_DATA:
+            USIDR = config.regs[reg_ptr];
+            DDRB |= SDA_PIN;
+            USISR = USISR_8BIT;
+            state = STATE_REQUEST_REPLY;
+            if (++reg_ptr >= config.size) {
+                reg_ptr = 0;
+            }
+            return;
+
+        case STATE_REQUEST_REPLY:
+            DDRB &= ~SDA_PIN;
+            USIDR = 0;
+            USISR = USISR_1BIT;
+            state = STATE_CHECK_REPLY;
+            return;
+
+        case STATE_REQUEST_DATA:
+            DDRB &= ~SDA_PIN;
+            USISR = USISR_8BIT;
+            state = STATE_GET_DATA;
+            return;
+
+        case STATE_GET_DATA:
+            i2c_slave_ack();
+            state = STATE_REQUEST_DATA;
+            if (reg_ptr_next) {
+                reg_ptr = data < config.size ? data : 0;
+                reg_ptr_next = 0;
+            } else {
+                i2c_slave_store(data);
+            }
+            return;
+    }
+}
@@ -1,70 +1,184 @@
 #include <stdint.h>
+#include <stddef.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include "attiny85/usi/spi.h"
+#include "attiny85/timer/timer0.h"
+#include "attiny85/util/bitrev.h"
+#include "spi_internal.h"
 
 #define USI_THREE_WIRE_MODE ((1 << USIWM0) | (0 << USIWM1))
 #define USI_EXTERNAL_CLOCK    ((1 << USICS1) | (0 << USICS0))
 #define USI_STROBE_CLOCK    ((1 << USICLK) | (1 << USITC))
 
-spi_t spi_init(spi_config_t config) {
-    uint8_t usicr_value;
+volatile uint8_t spi_async_busy;
 
-    DDRB |= (1 << config.sclk_pin) | (1 << config.mosi_pin);
-    DDRB &= ~(1 << config.miso_pin);
+static uint8_t spi_usicr_for_mode(spi_mode_t mode) {
+    uint8_t usicr = USI_THREE_WIRE_MODE | USI_EXTERNAL_CLOCK | USI_STROBE_CLOCK;
 
-    PORTB &= ~((1 << config.mosi_pin) | (1 << config.miso_pin) | (1 << config.sclk_pin));
+    if (mode == SPI_MODE_1 || mode == SPI_MODE_2) {
+        usicr |= (1 << USICS0);
+    }
 
-    usicr_value = USI_THREE_WIRE_MODE;
+    return usicr;
+}
 
-    switch (config.mode) {
-        case SPI_MODE_0:
-            usicr_value |= USI_EXTERNAL_CLOCK;
+// One compare match per SCK edge: half an SCK period per match
+static void spi_timer_for_clock(spi_clock_t clock, uint8_t *prescaler, uint8_t *top) {
+    switch (clock) {
+        case SPI_CLK_DIV64:
+            *prescaler = TIMER0_PRESCALER_1;
+            *top = 31;
+            break;
+        case SPI_CLK_DIV128:
+            *prescaler = TIMER0_PRESCALER_1;
+            *top = 63;
+            break;
+        case SPI_CLK_DIV256:
+            *prescaler = TIMER0_PRESCALER_1;
+            *top = 127;
             break;
-        case SPI_MODE_1:
-            usicr_value |= USI_EXTERNAL_CLOCK | (1 << USICS0);
+        case SPI_CLK_DIV1024:
+            *prescaler = TIMER0_PRESCALER_8;
+            *top = 63;
             break;
-        case SPI_MODE_2:
-            usicr_value |= USI_EXTERNAL_CLOCK;
+        case SPI_CLK_DIV4096:
+            *prescaler = TIMER0_PRESCALER_8;
+            *top = 255;
             break;
-        case SPI_MODE_3:
-            usicr_value |= USI_EXTERNAL_CLOCK | (1 << USICS0);
+        default:
+            *prescaler = 0;
+            *top = 0;
             break;
     }
+}
+
+static void spi_set_idle_level(spi_t *spi) {
+    if (spi->config.mode == SPI_MODE_2 || spi->config.mode == SPI_MODE_3) {
+        PORTB |= (1 << spi->config.sclk_pin);
+    } else {
+        PORTB &= ~(1 << spi->config.sclk_pin);
+    }
+}
+
+spi_t spi_init(spi_config_t config) {
+    spi_t spi = { .config = config, .device = NULL };
+
+    DDRB |= (1 << config.sclk_pin) | (1 << config.mosi_pin);
+    DDRB &= ~(1 << config.miso_pin);
+
+    PORTB &= ~((1 << config.mosi_pin) | (1 << config.miso_pin) | (1 << config.sclk_pin));
 
-    USICR = usicr_value;
+    spi.usicr = spi_usicr_for_mode(config.mode);
+    spi_timer_for_clock(config.clock, &spi.timer_prescaler, &spi.timer_top);
+    spi_set_idle_level(&spi);
+
+    USICR = spi.usicr & ~(1 << USITC);
 
-    spi_t spi = { .config = config };
     return spi;
 }
 
-uint8_t spi_transfer(spi_t *spi, uint8_t data) {
-    uint8_t tempUSISR;
-    uint8_t usicr_value;
+static uint8_t spi_shift_polled(spi_t *spi, uint8_t data) {
+    uint8_t usicr = spi->usicr;
+    uint8_t lsb_first = spi->config.bit_order == SPI_BIT_ORDER_LSB_FIRST;
     uint8_t sreg;
+    uint8_t recv;
 
-    USIDR = data;
+    // USI shifts MSB first only
+    USIDR = lsb_first ? hal_bitrev8(data) : data;
     USISR = (1 << USIOIF);
 
-    tempUSISR = USI_THREE_WIRE_MODE | USI_EXTERNAL_CLOCK | USI_STROBE_CLOCK;
-
     sreg = SREG;
     cli();
 
-    do {
-        USICR = tempUSISR;
-        while (!(USISR & (1 << USIOIF)));
-    } while (1);
+    if (spi->config.clock == SPI_CLK_DIV2) {
+        // 16 back-to-back OUTs, each toggles SCK
+        USICR = usicr; USICR = usicr;
+        USICR = usicr; USICR = usicr;
+        USICR = usicr; USICR = usicr;
+        USICR = usicr; USICR = usicr;
+        USICR = usicr; USICR = usicr;
+        USICR = usicr; USICR = usicr;
+        USICR = usicr; USICR = usicr;
+        USICR = usicr; USICR = usicr;
+    } else {
+        do {
+            USICR = usicr;
+        } while (!(USISR & (1 << USIOIF)));
+    }
 
     SREG = sreg;
 
-    return USIBR;
+    recv = USIBR;
+    return lsb_first ? hal_bitrev8(recv) : recv;
+}
+
+static uint8_t spi_is_polled(spi_t *spi) {
+    return spi->config.clock <= SPI_CLK_DIV8;
+}
+
+/*
+ * Timer0-clocked rates without interrupts: one USITC strobe per compare
+ * match, polled on OCF0A. Other interrupts only stretch SCK. No ISR is
+ * involved, so this links with i2c_slave and i2c_async.
+ */
+static void spi_transfer_timed(spi_t *spi, const uint8_t *tx, uint8_t *rx, uint16_t len) {
+    uint8_t usicr = spi->usicr;
+    uint8_t lsb_first = spi->config.bit_order == SPI_BIT_ORDER_LSB_FIRST;
+
+    TCCR0B = 0;
+    TIMSK &= ~(1 << OCIE0A);
+    TCCR0A = (1 << WGM01);
+    TCNT0 = 0;
+    OCR0A = spi->timer_top;
+    TIFR = (1 << OCF0A);
+    TCCR0B = spi->timer_prescaler;
+
+    for (uint16_t i = 0; i < len; i++) {
+        uint8_t data = tx ? tx[i] : 0xFF;
+
+        USIDR = lsb_first ? hal_bitrev8(data) : data;
+        USISR = (1 << USIOIF);
+
+        do {
+            while (!(TIFR & (1 << OCF0A))) {
+            }
+            TIFR = (1 << OCF0A);
+            USICR = usicr;
+        } while (!(USISR & (1 << USIOIF)));
+
+        uint8_t recv = USIBR;
+        if (rx) {
+            rx[i] = lsb_first ? hal_bitrev8(recv) : recv;
+        }
+    }
+
+    TCCR0B = 0;
+}
+
+uint8_t spi_transfer(spi_t *spi, uint8_t data) {
+    uint8_t recv;
+
+    while (spi_async_busy);
+
+    if (spi_is_polled(spi)) {
+        return spi_shift_polled(spi, data);
+    }
+
+    spi_transfer_timed(spi, &data, &recv, 1);
+    return recv;
 }
 
 void spi_transfer_buf(spi_t *spi, const uint8_t *tx, uint8_t *rx, uint16_t len) {
+    while (spi_async_busy);
+
+    if (!spi_is_polled(spi)) {
+        spi_transfer_timed(spi, tx, rx, len);
+        return;
+    }
+
     for (uint16_t i = 0; i < len; i++) {
-        uint8_t data = tx[i];
-        uint8_t recv = spi_transfer(spi, data);
+        uint8_t recv = spi_shift_polled(spi, tx ? tx[i] : 0xFF);
         if (rx) {
             rx[i] = recv;
         }
@@ -72,7 +186,49 @@ void spi_transfer_buf(spi_t *spi, const uint8_t *tx, uint8_t *rx, uint16_t len)
 }
 
 void spi_write(spi_t *spi, const uint8_t *data, uint16_t len) {
-    for (uint16_t i = 0; i < len; i++) {
-        spi_transfer(spi, data[i]);
+    spi_transfer_buf(spi, data, NULL, len);
+}
+
+void spi_device_init(spi_t *spi, spi_device_t *dev) {
+    PORTB |= (1 << dev->cs_pin);
+    DDRB |= (1 << dev->cs_pin);
+
+    dev->usicr = spi_usicr_for_mode(dev->mode);
+    spi_timer_for_clock(dev->clock, &dev->timer_prescaler, &dev->timer_top);
+
+    // Settings may have changed under the same pointer
+    if (spi->device == dev) {
+        spi->device = NULL;
     }
 }
+
+void spi_transaction(spi_t *spi, const spi_device_t *dev, const spi_segment_t *segments,
+                     uint8_t count) {
+    while (spi_async_busy);
+
+    if (spi->device != dev) {
+        spi->config.mode = dev->mode;
+        spi->config.bit_order = dev->bit_order;
+        spi->config.clock = dev->clock;
+        spi->usicr = dev->usicr;
+        spi->timer_prescaler = dev->timer_prescaler;
+        spi->timer_top = dev->timer_top;
+        spi->device = dev;
+
+        spi_set_idle_level(spi);
+        USICR = dev->usicr & ~(1 << USITC);
+    }
+
+    PORTB &= ~(1 << dev->cs_pin);
+
+    for (uint8_t i = 0; i < count; i++) {
+        spi_transfer_buf(spi, segments[i].tx, segments[i].rx, segments[i].len);
+    }
+
+    PORTB |= (1 << dev->cs_pin);
+}
+
+uint8_t spi_is_busy(spi_t *spi) {
+    (void)spi;
+    return spi_async_busy;
+}
@@ -0,0 +1,99 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "attiny85/usi/spi.h"
+#include "attiny85/util/bitrev.h"
+#include "spi_internal.h"
+
+// Interrupt-driven transfers at the Timer0-clocked rates. Kept out of
+// spi.c so the vectors below are only linked in when spi_transfer_async()
+// is called, and the blocking API still links with i2c_slave and i2c_async.
+
+#define USI_STROBE_CLOCK    ((1 << USICLK) | (1 << USITC))
+
+static const uint8_t *spi_tx;
+static uint8_t *spi_rx;
+static uint16_t spi_remaining;
+static spi_callback_t spi_callback;
+static uint8_t spi_lsb_first;
+
+void spi_transfer_async(spi_t *spi, const uint8_t *tx, uint8_t *rx, uint16_t len,
+                        spi_callback_t callback) {
+    while (spi_async_busy);
+
+    // The unrolled and looped strobe rates finish faster than the
+    // interrupts could
+    if (len == 0 || spi->config.clock <= SPI_CLK_DIV8) {
+        spi_transfer_buf(spi, tx, rx, len);
+        if (callback) {
+            callback();
+        }
+        return;
+    }
+
+    uint8_t first = tx ? *tx++ : 0xFF;
+    spi_lsb_first = spi->config.bit_order == SPI_BIT_ORDER_LSB_FIRST;
+    USIDR = spi_lsb_first ? hal_bitrev8(first) : first;
+    spi_tx = tx;
+    spi_rx = rx;
+    spi_remaining = len;
+    spi_callback = callback;
+    spi_async_busy = 1;
+
+    // Counter is clocked by the USCK pin edges that the Timer0 ISR produces
+    USISR = (1 << USIOIF);
+    USICR = (spi->usicr & ~USI_STROBE_CLOCK) | (1 << USIOIE);
+
+    TCCR0B = 0;
+    TCCR0A = (1 << WGM01);
+    TCNT0 = 0;
+    OCR0A = spi->timer_top;
+    TIFR = (1 << OCF0A);
+    TIMSK |= (1 << OCIE0A);
+    TCCR0B = spi->timer_prescaler;
+}
+
+/*
+ * One SCK edge per compare match. SBI on USICR reads USITC back as zero,
+ * so it is a pure strobe. The edge is held back while a completed byte
+ * is still waiting in USIBR (USIOIF set), which stretches the clock
+ * instead of shifting stale data when the overflow ISR runs late.
+ * Neither instruction touches SREG, so no context needs saving.
+ */
+ISR(TIMER0_COMPA_vect, ISR_NAKED) {
+    __asm__ __volatile__(
+        "sbis %[usisr], %[usioif]"  "\n\t"
+        "sbi  %[usicr], %[usitc]"   "\n\t"
+        "reti"                      "\n\t"
+        :
+        : [usisr] "I" (_SFR_IO_ADDR(USISR)), [usioif] "I" (USIOIF),
+          [usicr] "I" (_SFR_IO_ADDR(USICR)), [usitc] "I" (USITC)
+    );
+}
+
+ISR(USI_OVF_vect) {
+    uint8_t data = USIBR;
+
+    if (--spi_remaining) {
+        uint8_t next = spi_tx ? *spi_tx++ : 0xFF;
+        USIDR = spi_lsb_first ? hal_bitrev8(next) : next;
+    } else {
+        TCCR0B = 0;
+        TIMSK &= ~(1 << OCIE0A);
+        USICR &= ~(1 << USIOIE);
+    }
+
+    USISR = (1 << USIOIF);
+
+    if (spi_rx) {
+        *spi_rx++ = spi_lsb_first ? hal_bitrev8(data) : data;
+    }
+
+    if (!spi_remaining) {
+        spi_async_busy = 0;
+        if (spi_callback) {
+            spi_callback();
+        }
+    }
+}
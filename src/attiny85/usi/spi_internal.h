@@ -0,0 +1,12 @@
+#ifndef HAL_USI_SPI_INTERNAL_H
+#define HAL_USI_SPI_INTERNAL_H
+
+#include <stdint.h>
+
+// Shared by spi.c and spi_async.c, not part of the public API
+
+// Set while spi_async.c has a transfer running; the blocking calls wait
+// for it before touching the USI
+extern volatile uint8_t spi_async_busy;
+
+#endif
@@ -0,0 +1,230 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "attiny85/usi/spi_slave.h"
+#include "attiny85/util/assert.h"
+
+#define USI_THREE_WIRE_MODE ((1 << USIWM0) | (0 << USIWM1))
+#define USI_EXTERNAL_CLOCK    ((1 << USICS1) | (0 << USICS0))
+
+#define DO_PIN      (1 << PB1)
+
+#define RX_MASK     (SPI_SLAVE_RX_SIZE - 1)
+#define TX_MASK     (SPI_SLAVE_TX_SIZE - 1)
+
+HAL_STATIC_ASSERT((SPI_SLAVE_RX_SIZE & RX_MASK) == 0, "SPI_SLAVE_RX_SIZE must be a power of two");
+HAL_STATIC_ASSERT((SPI_SLAVE_TX_SIZE & TX_MASK) == 0, "SPI_SLAVE_TX_SIZE must be a power of two");
+
+static spi_slave_config_t config;
+static uint8_t usicr_value;
+
+// Byte for the next slot, written to USIDR by the overflow trampoline
+static volatile uint8_t spi_slave_next;
+static uint8_t spi_slave_index;
+static uint8_t spi_slave_overrun_count;
+
+static uint8_t rx_buf[SPI_SLAVE_RX_SIZE];
+static volatile uint8_t rx_head;
+static volatile uint8_t rx_tail;
+
+// tx_peek runs ahead of tx_tail by the ring bytes handed to the USI but
+// not yet clocked out. tx_inflight bit 0 is set when the byte in USIDR
+// came from the ring, bit 1 when spi_slave_next did.
+static uint8_t tx_buf[SPI_SLAVE_TX_SIZE];
+static volatile uint8_t tx_head;
+static volatile uint8_t tx_tail;
+static uint8_t tx_peek;
+static uint8_t tx_inflight;
+
+static void spi_slave_prepare_next(void) {
+    uint8_t peek = tx_peek;
+
+    if (peek != tx_head) {
+        spi_slave_next = tx_buf[peek];
+        tx_peek = (peek + 1) & TX_MASK;
+        tx_inflight |= 0x02;
+    } else {
+        spi_slave_next = 0xFF;
+    }
+}
+
+// The byte in USIDR has been clocked out and spi_slave_next replaced it
+static void spi_slave_commit_oldest(void) {
+    if (tx_inflight & 0x01) {
+        tx_tail = (tx_tail + 1) & TX_MASK;
+    }
+    tx_inflight >>= 1;
+}
+
+/*
+ * Bookkeeping for a completed byte, shared by the overflow interrupt and
+ * the CS release. Inlined so the signal handler makes no call.
+ */
+static inline void spi_slave_byte_done(void) __attribute__((always_inline));
+
+static inline void spi_slave_byte_done(void) {
+    uint8_t data = USIBR;
+    uint8_t index = spi_slave_index++;
+
+    if (config.on_byte) {
+        spi_slave_next = config.on_byte(index, data);
+        return;
+    }
+
+    spi_slave_commit_oldest();
+    spi_slave_prepare_next();
+
+    uint8_t head = rx_head;
+    uint8_t next = (head + 1) & RX_MASK;
+    if (next == rx_tail) {
+        spi_slave_overrun_count++;
+    } else {
+        rx_buf[head] = data;
+        rx_head = next;
+    }
+}
+
+static void spi_slave_cs_changed(gpio_pin_t pin) {
+    if (PINB & _BV(pin)) {
+        USICR = usicr_value;
+        DDRB &= ~DO_PIN;
+
+        // PCINT0 outranks USI_OVF, so the last byte may still be pending
+        if (USISR & (1 << USIOIF)) {
+            USISR = (1 << USIOIF);
+            spi_slave_byte_done();
+        }
+
+        // Ring bytes loaded but not clocked out are sent in the next frame
+        tx_peek = tx_tail;
+        tx_inflight = 0;
+
+        if (config.on_frame) {
+            config.on_frame(spi_slave_index);
+        }
+        return;
+    }
+
+    spi_slave_index = 0;
+
+    if (config.on_byte) {
+        USIDR = 0xFF;
+        spi_slave_next = 0xFF;
+    } else {
+        // Slot 0 goes straight to USIDR, slot 1 waits in spi_slave_next
+        spi_slave_prepare_next();
+        USIDR = spi_slave_next;
+        tx_inflight >>= 1;
+        spi_slave_prepare_next();
+    }
+
+    USISR = (1 << USIOIF);
+    DDRB |= DO_PIN;
+    USICR = usicr_value | (1 << USIOIE);
+}
+
+spi_slave_t spi_slave_init(spi_slave_config_t cfg) {
+    config = cfg;
+
+    DDRB &= ~((1 << PB0) | (1 << PB1) | (1 << PB2));
+    PORTB &= ~((1 << PB0) | (1 << PB1) | (1 << PB2));
+
+    gpio_init(cfg.cs_pin, GPIO_MODE_INPUT_PULLUP);
+
+    usicr_value = USI_THREE_WIRE_MODE | USI_EXTERNAL_CLOCK;
+    if (cfg.mode == SPI_MODE_1 || cfg.mode == SPI_MODE_2) {
+        usicr_value |= (1 << USICS0);
+    }
+    USICR = usicr_value;
+
+    rx_head = rx_tail = 0;
+    tx_head = tx_tail = tx_peek = 0;
+    tx_inflight = 0;
+    spi_slave_overrun_count = 0;
+
+    gpio_enable_pcint(cfg.cs_pin, spi_slave_cs_changed);
+
+    spi_slave_t slave = { .config = cfg };
+    return slave;
+}
+
+void spi_slave_deinit(spi_slave_t *slave) {
+    gpio_disable_pcint(slave->config.cs_pin);
+    USICR = 0;
+    DDRB &= ~DO_PIN;
+}
+
+uint8_t spi_slave_available(spi_slave_t *slave) {
+    (void)slave;
+    return (rx_head - rx_tail) & RX_MASK;
+}
+
+uint8_t spi_slave_read(spi_slave_t *slave, uint8_t *data) {
+    (void)slave;
+    uint8_t tail = rx_tail;
+
+    if (tail == rx_head) {
+        return 0;
+    }
+
+    *data = rx_buf[tail];
+    rx_tail = (tail + 1) & RX_MASK;
+    return 1;
+}
+
+uint8_t spi_slave_write(spi_slave_t *slave, uint8_t data) {
+    (void)slave;
+    uint8_t head = tx_head;
+    uint8_t next = (head + 1) & TX_MASK;
+
+    if (next == tx_tail) {
+        return 0;
+    }
+
+    tx_buf[head] = data;
+    tx_head = next;
+    return 1;
+}
+
+uint8_t spi_slave_overruns(spi_slave_t *slave) {
+    (void)slave;
+    uint8_t sreg = SREG;
+    cli();
+    uint8_t count = spi_slave_overrun_count;
+    spi_slave_overrun_count = 0;
+    SREG = sreg;
+    return count;
+}
+
+/*
+ * Body of the overflow interrupt, entered from the trampoline below with
+ * the next byte already in USIDR. Runs as a normal signal handler so the
+ * full register save only delays the bookkeeping, not the reload.
+ */
+static void __vector_spi_slave_overflow(void) __attribute__((signal, used));
+
+static void __vector_spi_slave_overflow(void) {
+    spi_slave_byte_done();
+}
+
+/*
+ * The host starts clocking the next byte half an SCK period after the
+ * overflow, so USIDR is reloaded before any register is saved: 4 cycles
+ * interrupt response, 2 vector RJMP, PUSH, LDS, OUT. None of these touch
+ * SREG. USIOIF is cleared here too so the counter restarts from zero.
+ */
+ISR(USI_OVF_vect, ISR_NAKED) {
+    __asm__ __volatile__(
+        "push r24"                          "\n\t"
+        "lds  r24, %[next]"                 "\n\t"
+        "out  %[usidr], r24"                "\n\t"
+        "ldi  r24, %[clear]"                "\n\t"
+        "out  %[usisr], r24"                "\n\t"
+        "pop  r24"                          "\n\t"
+        "rjmp __vector_spi_slave_overflow"  "\n\t"
+        :
+        : [next] "i" (&spi_slave_next), [usidr] "I" (_SFR_IO_ADDR(USIDR)),
+          [usisr] "I" (_SFR_IO_ADDR(USISR)), [clear] "M" (1 << USIOIF)
+    );
+}